@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <uterm.h>
+#include <glyph.h>
+
+/*
+ * 无显示的吞吐量测试：向 malloc 的帧缓冲回放固定的负载。
+ * 每个负载按两种方式各运行一次，输出一行 key=value，字段顺序固定，便于版本间比较：
+ *   present  每写入一块 flush 一次，即一帧，包括光栅化和复制到帧缓冲
+ *   ingest   只解析和写入单元，不计 flush，用于比较解析、扫描和清除的改动；没有帧，fps 为 -
+ */
+
+#define WIDTH  1024
+#define HEIGHT 768
+
+// 与库使用相同的字形尺寸，由 Makefile 的 FONT_W/FONT_H 传入
+#define COLS (WIDTH / UGLYPH_WIDTH)
+#define ROWS (HEIGHT / UGLYPH_HEIGHT)
+
+#define WORKLOAD_BYTES (4 * 1024 * 1024)
+#define CHUNK 4096 // 每次写入的字节数
+
+typedef struct buf
+{
+    char *data;
+    size_t len;
+    size_t cap;
+} buf_t;
+
+static uint32_t seed = 12345;
+
+// 固定种子的线性同余，保证每次生成相同的负载
+static uint32_t rnd(void) {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+}
+
+static void put(buf_t *b, const char *s, size_t n) {
+    if (b->len + n > b->cap) n = b->cap - b->len;
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+}
+
+static void putf(buf_t *b, const char *fmt, int a, int c) {
+    char tmp[32];
+    int n = snprintf(tmp, sizeof(tmp), fmt, a, c);
+    put(b, tmp, n);
+}
+
+static char printable(void) {
+    return 0x21 + rnd() % 94;
+}
+
+// 整行的可打印字符
+static void gen_dense_ascii(buf_t *b) {
+    while (b->len < b->cap) {
+        char line[COLS];
+        for (int i = 0; i < COLS; i++) line[i] = printable();
+        put(b, line, COLS);
+    }
+}
+
+// 每个单词都带颜色和属性
+static void gen_sgr_color(buf_t *b) {
+    while (b->len < b->cap) {
+        putf(b, "\033[%d;%dm", 30 + rnd() % 8, 40 + rnd() % 8);
+        if (rnd() % 4 == 0) put(b, "\033[1m", 4);
+        int n = 2 + rnd() % 8;
+        for (int i = 0; i < n; i++) {
+            char c = printable();
+            put(b, &c, 1);
+        }
+        put(b, "\033[0m ", 5);
+    }
+}
+
+// 短行，几乎每行都滚屏
+static void gen_scroll_lines(buf_t *b) {
+    int line = 0;
+    while (b->len < b->cap) {
+        putf(b, "line %d %d\n", line++, rnd());
+    }
+}
+
+// 按行定位后重写整屏
+static void gen_cursor_redraw(buf_t *b) {
+    while (b->len < b->cap) {
+        for (int y = 1; y <= ROWS && b->len < b->cap; y++) {
+            putf(b, "\033[%d;%dH", y, 1);
+            char line[COLS - 1];
+            for (int i = 0; i < COLS - 1; i++) line[i] = printable();
+            put(b, line, COLS - 1);
+        }
+    }
+}
+
+// 清屏、清行与少量输出交替
+static void gen_erase_storm(buf_t *b) {
+    while (b->len < b->cap) {
+        put(b, "\033[2J", 4);
+        for (int i = 0; i < 8; i++) {
+            putf(b, "\033[%d;%dH", 1 + rnd() % ROWS, 1 + rnd() % COLS);
+            put(b, "erase", 5);
+            put(b, "\033[K", 3);
+        }
+    }
+}
+
+// 每帧整屏重写，只有第一行的计数变化（仪表盘刷新），其余的行与屏幕上相同
+static void gen_dashboard_refresh(buf_t *b) {
+    char screen[ROWS][COLS - 1];
+    int frame = 0;
+
+    for (int y = 0; y < ROWS; y++) {
+        for (int i = 0; i < COLS - 1; i++) screen[y][i] = printable();
+    }
+    while (b->len < b->cap) {
+        putf(b, "\033[H\033[7mframe %d %d\033[0m", frame++, 0);
+        for (int y = 1; y < ROWS && b->len < b->cap; y++) {
+            putf(b, "\033[%d;%dH", y + 1, 1);
+            put(b, screen[y], COLS - 1);
+        }
+    }
+}
+
+// 换背景色后清屏，再写几行短文本（全屏界面切换配色）
+static void gen_color_clear(buf_t *b) {
+    int frame = 0;
+
+    while (b->len < b->cap) {
+        putf(b, "\033[%d;%dm\033[2J", 40 + frame++ % 8, 37);
+        for (int i = 0; i < 8; i++) {
+            putf(b, "\033[%d;%dH", 1 + rnd() % ROWS, 1 + rnd() % (COLS - 16));
+            put(b, "status: ok", 10);
+        }
+    }
+}
+
+static const struct
+{
+    const char *name;
+    void (*gen)(buf_t *b);
+} workloads[] = {
+    { "dense_ascii", gen_dense_ascii },
+    { "sgr_color", gen_sgr_color },
+    { "scroll_lines", gen_scroll_lines },
+    { "cursor_redraw", gen_cursor_redraw },
+    { "erase_storm", gen_erase_storm },
+    { "dashboard_refresh", gen_dashboard_refresh },
+    { "color_clear", gen_color_clear },
+};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static const char *modes[] = { "present", "ingest" };
+
+// 回放一遍，返回耗时；ingest 在计时结束后才 flush
+static double replay(uterm_t *ut, const buf_t *b, int present, size_t *frames) {
+    double start = now();
+
+    for (size_t off = 0; off < b->len; off += CHUNK) {
+        size_t n = b->len - off < CHUNK ? b->len - off : CHUNK;
+        uterm_ctx_write(ut, b->data + off, n);
+        if (present) {
+            uterm_ctx_flush(ut);
+            (*frames)++;
+        }
+    }
+
+    double elapsed = now() - start;
+    if (!present) uterm_ctx_flush(ut); // 不计帧
+    return elapsed;
+}
+
+int main(int argc, char **argv) {
+    const char *only = argc > 1 ? argv[1] : NULL; // 只运行指定的负载
+    uint32_t *fb = malloc(WIDTH * HEIGHT * sizeof(uint32_t));
+    buf_t b = { malloc(WORKLOAD_BYTES), 0, WORKLOAD_BYTES };
+
+    printf("# uterm-bench 2 width=%d height=%d cell=%dx%d chunk=%d\n", WIDTH, HEIGHT, UGLYPH_WIDTH, UGLYPH_HEIGHT, CHUNK);
+
+    for (size_t i = 0; i < sizeof(workloads) / sizeof(workloads[0]); i++) {
+        if (only && strcmp(only, workloads[i].name) != 0) continue;
+
+        seed = 12345;
+        b.len = 0;
+        workloads[i].gen(&b);
+
+        for (int m = 0; m < 2; m++) {
+            uterm_t *ut = uterm_ctx_create(fb, WIDTH, HEIGHT, malloc, free);
+            size_t frames = 0;
+
+            replay(ut, &b, !m, &frames); // 预热字形缓存
+            frames = 0;
+            double elapsed = replay(ut, &b, !m, &frames);
+
+            uterm_ctx_destroy(ut);
+
+            char fps[32] = "-";
+            if (frames) snprintf(fps, sizeof(fps), "%.1f", frames / elapsed);
+
+            printf("workload=%s mode=%s bytes=%zu seconds=%.6f mib_s=%.2f ns_byte=%.3f fps=%s\n",
+                workloads[i].name, modes[m], b.len, elapsed,
+                b.len / elapsed / (1024 * 1024),
+                elapsed * 1e9 / b.len,
+                fps);
+        }
+    }
+
+    free(b.data);
+    free(fb);
+    return 0;
+}
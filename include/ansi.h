@@ -2,6 +2,7 @@
 #define INCLUDE_ANSI_H_
 
 #include <stdint.h>
+#include <vtparse.h>
 
 enum ansi_color {
 	ANSI_COLOR_BLACK = 0,
@@ -15,14 +16,27 @@ enum ansi_color {
 };
 
 typedef struct vt100 {
-	int status;				// 状态机：0-正常，1-收到ESC，2-收到CSI [
-	int params[4];			// 参数存储
-	int param_count;
-	char command;
-	uint32_t current_fg;	// 当前前景色（RGBA）
-	uint32_t current_bg;	// 当前背景色（RGBA）
+	uint8_t state;			// 解析器状态（enum uvt_state）
+	uint8_t private_marker;		// CSI 私有标记 '<' '=' '>' '?'，没有为 0
+	uint8_t intermediate_count;
+	char intermediates[UVT_MAX_INTERMEDIATES];
+	int params[UVT_MAX_PARAMS];	// 参数存储
+	int param_count;		// 已开始的参数个数
+	int param_overflow;		// 参数超过 UVT_MAX_PARAMS 后忽略其余的参数
+	uint32_t param_sub;		// 第 i 位为 1 表示参数 i 是 ':' 分隔的子参数
+	char osc[UVT_OSC_MAX];		// OSC 字符串（截断）
+	int osc_len;
+	uint32_t utf8_cp;		// 未完成的 UTF-8 序列
+	uint8_t utf8_need;		// 还需要的后续字节数
+	uint8_t utf8_lower, utf8_upper; // 下一个后续字节的范围，排除过长编码和代理
+	uint32_t current_fg;	// 当前前景色（目标像素格式）
+	uint32_t current_bg;	// 当前背景色（目标像素格式）
 	int bold;				// 粗体标志位
 	int underline;			// 下划线标志位
+	int reverse;			// 反显标志位
+	uint32_t saved_x, saved_y;	// DECSC/DECRC 保存的光标和属性
+	uint32_t saved_fg, saved_bg;
+	int saved_bold, saved_underline, saved_reverse;
 } vt100_t;
 
 #endif // INCLUDE_ANSI_H_
@@ -4,12 +4,28 @@
 #include <stdint.h>
 #include <stddef.h>
 
+/* 字符单元属性标志位 */
+#define UCELL_ATTR_BOLD      0x01
+#define UCELL_ATTR_UNDERLINE 0x02
+#define UCELL_ATTR_REVERSE   0x04
+#define UCELL_ATTR_WIDE      0x08 // 宽字符的左半部分
+#define UCELL_ATTR_WIDE_TAIL 0x10 // 宽字符的右半部分，ch 与左半部分相同
+#define UCELL_ATTR_INVALID   0x80000000 // 仅用于前缓冲，强制重新光栅化
+
+typedef struct ucell
+{
+	uint32_t ch;   // 码点
+	uint32_t fg;   // 前景色（目标像素格式）
+	uint32_t bg;   // 背景色（目标像素格式）
+	uint32_t attr; // 属性标志位
+} ucell_t;
+
 typedef struct ubuffer
 {
-	uint32_t *fb;
-	char *cell;
-	int dirty_start; // 起始脏行
-	int dirty_end;   // 结束脏行
+	uint8_t *fb;       // 每行 pitch 字节
+	ucell_t *cell;
+	uint32_t *changed; // 已修改单元的位图，每行 bitmap_stride 个字
+	uint32_t *damage;  // 待复制到前缓冲的损坏单元位图
 } ubuffer_t;
 
 typedef struct char_under_cursor
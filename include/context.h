@@ -0,0 +1,104 @@
+#ifndef INCLUDE_CONTEXT_H_
+#define INCLUDE_CONTEXT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <uterm.h>
+#include <ansi.h>
+#include <buffer.h>
+#include <glyph.h>
+#include <glyphmap.h>
+#include <font.h>
+#include <workers.h>
+#include <ring.h>
+#include <scrollback.h>
+
+#ifndef UTERM_TRUECOLOR_CACHE
+#define UTERM_TRUECOLOR_CACHE 64 // 24 位颜色换算结果的缓存项数，2 的幂
+#endif
+#define UTERM_TRUECOLOR_VALID 0x01000000
+
+#ifndef UTERM_PARALLEL_MIN_ROWS
+#define UTERM_PARALLEL_MIN_ROWS 8 // 需要光栅化的行数达到此值才分给工作线程
+#endif
+
+/* 统计计数，未定义 UTERM_STATS 时完全不编译 */
+#ifdef UTERM_STATS
+#define USTAT_ADD(ut, field, n) ((ut)->stats.field += (n))
+#define USTAT_ATOMIC_ADD(ut, field, n) __atomic_add_fetch(&(ut)->stats.field, (n), __ATOMIC_RELAXED)
+#define USTAT_NOW(ut) ((ut)->clock ? (ut)->clock() : 0)
+#define USTAT_TIME(ut, field, start) ((ut)->stats.field += USTAT_NOW(ut) - (start))
+#else
+#define USTAT_ADD(ut, field, n) ((void) 0)
+#define USTAT_ATOMIC_ADD(ut, field, n) ((void) 0)
+#define USTAT_NOW(ut) 0
+#define USTAT_TIME(ut, field, start) ((void) (start))
+#endif
+
+/* 一个终端实例的全部状态，不同实例之间不共享可写数据 */
+struct uterm
+{
+	ssize_t term_width;		// Terminal width
+	ssize_t term_height;		// Terminal height
+	uint32_t cell_count;		// The count of all the cells.
+	uint32_t cell_cols;		// The count of the cells of col.
+	uint32_t cell_lines;		// The count of the cells of line.
+	uint32_t bitmap_stride;		// 位图（修改/损坏）每行的字数
+	uint32_t row_origin;		// 屏幕第 0 行在后缓冲中的物理行（环形）
+	uint32_t scroll_top;		// 滚动区域（DECSTBM）为屏幕行 [scroll_top, scroll_bottom)
+	uint32_t scroll_bottom;
+
+	int format;			// 像素格式（UTERM_FORMAT_*）
+	uint32_t bpp;			// 每个像素的字节数
+	size_t pitch;			// 每行像素的字节数
+	uint32_t palette[256];		// 换算为像素格式的 256 色
+	uint32_t truecolor_key[UTERM_TRUECOLOR_CACHE];	// RGB | UTERM_TRUECOLOR_VALID，直接映射
+	uint32_t truecolor_pixel[UTERM_TRUECOLOR_CACHE];
+
+	ubuffer_t front_buffer;
+	ubuffer_t back_buffer;
+
+	vt100_t vtcontrol;
+
+	uglyph_cache_t glyph_cache;	// 调用 flush 的线程使用
+	size_t glyph_cache_budget;	// 所有字形缓存的总预算
+
+	uworker_pool_t workers;		// 光栅化工作线程
+	uglyph_cache_t *worker_caches;	// 每个工作线程一个字形缓存
+	uint32_t *raster_rows;		// 本次 flush 需要光栅化的物理行
+	uint32_t raster_count;
+
+	uring_t input;			// uterm_enqueue 写入，uterm_drain 处理
+
+	uint8_t *pages[2];		// 双页显示时的两页显存，否则为 0
+	uint32_t *page_damage[2];	// 每页自上次显示以来的损坏位图
+	uint32_t page_cursor[2][2];	// 每页上绘制光标的位置
+	int page_cursor_drawn[2];
+	int page;			// 正在显示的页
+	void (*present)(int page);
+	void (*damage)(int x, int y, int w, int h); // 报告前缓冲中修改的矩形
+
+#ifdef UTERM_STATS
+	uterm_stats_t stats;
+	uint64_t (*clock)(void);	// 宿主提供的时钟
+#endif
+
+	uscrollback_t scrollback;	// 滚出屏幕的行
+	ucell_t *history_row;		// 解码历史行用
+
+	ufont_t font;			// 当前字体，字形不复制
+	const void *font_file;		// uterm_load_font 映射的文件
+	size_t font_file_size;
+	uglyph_map_t glyph_map;		// 码点到字形
+	int blank_fill;			// 空白字形没有点，空白单元直接填充颜色
+
+	int cursor_visible;		// 光标是否显示
+	int cursor_drawn;		// 光标是否已叠加在前缓冲上
+	uint32_t saved_cursor_cellx, saved_cursor_celly;	// 前缓冲上光标的位置
+	uint32_t cursorx, cursory;
+
+	void *(*umalloc)(size_t target);	// uterm malloc
+	void (*ufree)(void *target);		// uterm free
+};
+
+#endif // INCLUDE_CONTEXT_H_
@@ -0,0 +1,38 @@
+#ifndef INCLUDE_FILL_H_
+#define INCLUDE_FILL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 定义 UFILL_NO_SIMD 可关闭 SIMD 填充内核
+#if !defined(UFILL_NO_SIMD) && (defined(__x86_64__) || defined(__i386__))
+#define UFILL_HAVE_X86 1
+#else
+#define UFILL_HAVE_X86 0
+#endif
+
+/*
+ * 用 32 位的 pattern 填充 rows 行，每行从 dst + i * pitch 开始的 bytes 个字节。
+ * bytes 为 4 的倍数，16 位像素的 pattern 为两个相同的像素。
+ */
+typedef void (*ufill_fn)(uint8_t *dst, size_t pitch, size_t bytes, uint32_t rows, uint32_t pattern);
+
+/* 当前使用的填充内核，由 ufill_select_kernel 选择 */
+extern ufill_fn ufill_kernel;
+
+static inline void ufill_rect(uint8_t *dst, size_t pitch, size_t bytes, uint32_t rows, uint32_t pattern) {
+	__atomic_load_n(&ufill_kernel, __ATOMIC_RELAXED)(dst, pitch, bytes, rows, pattern);
+}
+
+/* 每个像素 bpp 字节时的 pattern */
+static inline uint32_t ufill_pattern(uint32_t pixel, uint32_t bpp) {
+	return bpp == 2 ? (pixel & 0xFFFF) * 0x10001u : pixel;
+}
+
+/* 按 CPU 特性选择填充内核（AVX2 > SSE2 > 标量），返回内核名称 */
+const char *ufill_select_kernel(void);
+
+/* 标量实现，供其它内核处理尾部 */
+void ufill_rect_c(uint8_t *dst, size_t pitch, size_t bytes, uint32_t rows, uint32_t pattern);
+
+#endif // INCLUDE_FILL_H_
@@ -0,0 +1,71 @@
+#ifndef INCLUDE_FONT_H_
+#define INCLUDE_FONT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <glyph.h>
+
+/*
+ * 字体只记录字形在内存中的位置，不复制也不解码。字形尺寸与编译时的
+ * 单元尺寸相同时直接展开，否则在字形缓存未命中时逐个缩放到单元尺寸。
+ */
+typedef struct ufont
+{
+	const uint8_t *glyphs;  // 第一个字形
+	uint32_t count;         // 字形数量
+	uint32_t width;         // 字形宽度（像素）
+	uint32_t height;        // 字形高度（像素）
+	uint32_t row_bytes;     // 每行字节数
+	uint32_t bytes;         // 每个字形的字节数
+	int native;             // 与单元尺寸相同
+	const uint8_t *unicode; // PSF2 的 Unicode 表，没有时为 NULL
+	uint32_t unicode_len;
+} ufont_t;
+
+#define UFONT_PSF2_MAGIC 0x864AB572
+#define UFONT_PSF2_HAS_UNICODE 0x01
+
+typedef struct ufont_psf2_header
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t header_size;  // 字形数据的偏移
+	uint32_t flags;
+	uint32_t length;       // 字形数量
+	uint32_t glyph_size;   // 每个字形的字节数
+	uint32_t height;
+	uint32_t width;
+} ufont_psf2_header_t;
+
+/* 宽字符占两个单元，字形按两个单元的宽度缩放后各取一半 */
+#define UFONT_WHOLE 0
+#define UFONT_LEFT  1
+#define UFONT_RIGHT 2
+
+/* 逐行存放的 1bpp 字形，例如内嵌字体 */
+void ufont_raw(ufont_t *font, const uint8_t *glyphs, uint32_t count, uint32_t width, uint32_t height);
+
+/* 检查 PSF2 数据，font 引用 data 中的字形，data 在使用期间必须有效；格式错误返回 -1 */
+int ufont_psf2(ufont_t *font, const void *data, size_t size);
+
+/* 把字形 glyph 缩放到单元尺寸写入 dst（UGLYPH_BYTES 字节），part 为 UFONT_WHOLE/LEFT/RIGHT */
+void ufont_fit(const ufont_t *font, uint32_t glyph, int part, uint8_t *dst);
+
+/* 可以直接展开的字形，需要缩放时返回 NULL */
+static inline const uint8_t *ufont_native(const ufont_t *font, uint32_t glyph, int part) {
+	return (font->native && part == UFONT_WHOLE) ? font->glyphs + glyph * font->bytes : NULL;
+}
+
+/* 码点表扫描函数（uglyph_scan_fn），source 为 PSF2 的 Unicode 表 */
+void ufont_psf2_scan(const void *source, uint32_t len, uint32_t base, uint32_t *entries);
+
+/* 没有 Unicode 表的字体：码点 i 为第 i 个字形，len 为字形数量 */
+void ufont_index_scan(const void *source, uint32_t len, uint32_t base, uint32_t *entries);
+
+#ifdef UTERM_MMAP
+/* 只读映射整个文件，失败返回 NULL */
+const void *ufont_map_file(const char *path, size_t *size);
+void ufont_unmap_file(const void *data, size_t size);
+#endif
+
+#endif // INCLUDE_FONT_H_
@@ -0,0 +1,100 @@
+#ifndef INCLUDE_GLYPH_H_
+#define INCLUDE_GLYPH_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * 字形（字符单元）尺寸在编译时确定，由 Makefile 的 FONT_W/FONT_H 传入，
+ * 展开内核的循环边界都是常量。支持 8x8、8x16、16x32。
+ */
+#ifndef UGLYPH_WIDTH
+#define UGLYPH_WIDTH  8
+#endif
+#ifndef UGLYPH_HEIGHT
+#define UGLYPH_HEIGHT 16
+#endif
+
+#if !((UGLYPH_WIDTH == 8 && UGLYPH_HEIGHT == 8) || \
+	(UGLYPH_WIDTH == 8 && UGLYPH_HEIGHT == 16) || \
+	(UGLYPH_WIDTH == 16 && UGLYPH_HEIGHT == 32))
+#error "Unsupported glyph size, use 8x8, 8x16 or 16x32"
+#endif
+
+#define UGLYPH_ROW_BYTES (UGLYPH_WIDTH / 8)                // 字形每行字节数
+#define UGLYPH_BYTES     (UGLYPH_ROW_BYTES * UGLYPH_HEIGHT) // 每个字形的字节数
+#define UGLYPH_PIXELS    (UGLYPH_WIDTH * UGLYPH_HEIGHT)
+
+#ifndef UGLYPH_CACHE_DEFAULT
+#define UGLYPH_CACHE_DEFAULT (256 * 1024) // 默认字形缓存预算（字节）
+#endif
+
+// 定义 UGLYPH_NO_SIMD 可关闭 SIMD 展开内核（例如交叉编译到裸机）
+#if !defined(UGLYPH_NO_SIMD) && (defined(__x86_64__) || defined(__i386__))
+#define UGLYPH_HAVE_X86 1
+#else
+#define UGLYPH_HAVE_X86 0
+#endif
+
+#define UGLYPH_CACHE_WAYS 2 // 每组两路，lru 中记录待替换的一路
+
+typedef struct uglyph_key
+{
+	uint32_t ch;
+	uint32_t fg;
+	uint32_t bg;
+	uint32_t valid; // 0-空，1-有效
+} uglyph_key_t;
+
+/* 展开后的 (字形, 前景色, 背景色) 图块缓存，组相联，组内 LRU */
+typedef struct uglyph_cache
+{
+	uglyph_key_t *keys;  // nsets * UGLYPH_CACHE_WAYS 个键
+	uint8_t *tiles;      // 每个键对应 UGLYPH_PIXELS 个像素
+	uint32_t bpp;        // 每个像素的字节数
+	uint8_t *lru;        // 每组最近最少使用的路
+	uint32_t set_mask;   // 组数 - 1，为 0 且 keys 为空时缓存关闭
+	uint64_t hits;
+	uint64_t misses;
+} uglyph_cache_t;
+
+/* 把 1bpp 字形展开到 dst，stride 为 dst 每行的像素数 */
+typedef void (*uglyph_expand_fn)(uint32_t *dst, size_t stride, const uint8_t *font, uint32_t fg, uint32_t bg);
+
+/* 当前使用的展开内核，由 uglyph_select_kernel 选择 */
+extern uglyph_expand_fn uglyph_expand_kernel;
+
+static inline void uglyph_expand(uint32_t *dst, size_t stride, const uint8_t *font, uint32_t fg, uint32_t bg) {
+	__atomic_load_n(&uglyph_expand_kernel, __ATOMIC_RELAXED)(dst, stride, font, fg, bg);
+}
+
+/* 16 位像素（RGB565）的展开内核 */
+typedef void (*uglyph_expand16_fn)(uint16_t *dst, size_t stride, const uint8_t *font, uint16_t fg, uint16_t bg);
+
+extern uglyph_expand16_fn uglyph_expand16_kernel;
+
+static inline void uglyph_expand16(uint16_t *dst, size_t stride, const uint8_t *font, uint16_t fg, uint16_t bg) {
+	__atomic_load_n(&uglyph_expand16_kernel, __ATOMIC_RELAXED)(dst, stride, font, fg, bg);
+}
+
+/* 按每个像素的字节数选择内核 */
+static inline void uglyph_expand_bpp(uint8_t *dst, size_t stride, const uint8_t *font, uint32_t fg, uint32_t bg, uint32_t bpp) {
+	if (bpp == 2) {
+		uglyph_expand16((uint16_t *) dst, stride, font, (uint16_t) fg, (uint16_t) bg);
+	} else {
+		uglyph_expand((uint32_t *) dst, stride, font, fg, bg);
+	}
+}
+
+/* 按 CPU 特性选择展开内核（32 位 AVX2 > SSE2 > C，16 位 SSE2 > C），返回 32 位内核名称 */
+const char *uglyph_select_kernel(void);
+
+/* budget 不足以容纳一组时缓存关闭，返回 0；bpp 为每个像素的字节数 */
+int uglyph_cache_init(uglyph_cache_t *cache, size_t budget, uint32_t bpp, void *(*malloc)(size_t));
+
+void uglyph_cache_destroy(uglyph_cache_t *cache, void (*free)(void*));
+
+/* 返回展开后的图块，缓存关闭时返回 NULL。font 为 NULL 时只查找，未命中返回 NULL */
+const uint8_t *uglyph_cache_get(uglyph_cache_t *cache, const uint8_t *font, uint32_t ch, uint32_t fg, uint32_t bg);
+
+#endif // INCLUDE_GLYPH_H_
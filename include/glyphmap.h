@@ -0,0 +1,68 @@
+#ifndef INCLUDE_GLYPHMAP_H_
+#define INCLUDE_GLYPHMAP_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * 码点到字形的两级查找表，覆盖 U+0000-U+FFFF。第一级按码点高 8 位分页，
+ * 每页 256 项，在页中的码点第一次写入时才建立，没有字形的页共用一页。
+ * 表项低位为字形下标，高位为宽度标志。
+ */
+#define UGLYPH_MAP_PAGES 256
+#define UGLYPH_MAP_PAGE_SIZE 256
+
+#define UGLYPH_MAP_WIDE  0x80000000 // 占两个单元
+#define UGLYPH_MAP_ZERO  0x40000000 // 零宽（组合字符等）
+#define UGLYPH_MAP_FONT  0x20000000 // 字体中有这个码点的字形
+#define UGLYPH_MAP_INDEX 0x00FFFFFF
+
+typedef struct uglyph_pair
+{
+	uint32_t cp;    // 码点
+	uint32_t glyph; // 字形下标
+} uglyph_pair_t;
+
+/*
+ * 码点表扫描函数：对 [base, base + 256) 中字体有字形的码点，
+ * 在 entries[cp - base] 为 0 时写入 字形下标 | UGLYPH_MAP_FONT。
+ */
+typedef void (*uglyph_scan_fn)(const void *source, uint32_t len, uint32_t base, uint32_t *entries);
+
+typedef struct uglyph_map
+{
+	uint32_t *pages[UGLYPH_MAP_PAGES]; // NULL-尚未建立
+	uint32_t *empty;                   // 没有字形的页共用
+	uglyph_scan_fn scan;               // 字体的码点表，在建立页时才扫描
+	const void *source;
+	uint32_t source_len;
+	uint32_t fallback;                 // 字体中没有的字符
+	uint32_t blank;                    // 空白单元和缺字形的宽字符右半部分
+} uglyph_map_t;
+
+/* source 为 len 个 uglyph_pair_t，顺序任意 */
+void uglyph_scan_pairs(const void *source, uint32_t len, uint32_t base, uint32_t *entries);
+
+/* ASCII 和 Latin-1 所在的第 0 页不经过查找就会写入单元，初始化时建立 */
+int uglyph_map_init(uglyph_map_t *map, uglyph_scan_fn scan, const void *source, uint32_t len, void *(*malloc)(size_t));
+void uglyph_map_destroy(uglyph_map_t *map, void (*free)(void*));
+
+/* 字符宽度标志（UGLYPH_MAP_WIDE/UGLYPH_MAP_ZERO），不需要字体 */
+uint32_t uglyph_width(uint32_t cp);
+
+/* 建立 cp 所在的页，分配失败时返回不带宽度的 fallback */
+uint32_t uglyph_map_fill(uglyph_map_t *map, uint32_t cp, void *(*malloc)(size_t));
+
+/* 写入字符时查找，页不存在时建立 */
+static inline uint32_t uglyph_map_get(uglyph_map_t *map, uint32_t cp, void *(*malloc)(size_t)) {
+	if (cp < UGLYPH_MAP_PAGES * UGLYPH_MAP_PAGE_SIZE && map->pages[cp >> 8]) return map->pages[cp >> 8][cp & 0xFF];
+	return uglyph_map_fill(map, cp, malloc);
+}
+
+/* 光栅化时查找，只读，可在工作线程中调用 */
+static inline uint32_t uglyph_map_find(const uglyph_map_t *map, uint32_t cp) {
+	const uint32_t *page = cp < UGLYPH_MAP_PAGES * UGLYPH_MAP_PAGE_SIZE ? map->pages[cp >> 8] : NULL;
+	return page ? page[cp & 0xFF] : map->fallback;
+}
+
+#endif // INCLUDE_GLYPHMAP_H_
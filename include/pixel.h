@@ -0,0 +1,73 @@
+#ifndef INCLUDE_PIXEL_H_
+#define INCLUDE_PIXEL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <uterm.h>
+
+/*
+ * 显存和后缓冲的像素格式（UTERM_FORMAT_*）。单元中的颜色在写入时
+ * 就换算为目标格式，光栅化和复制不再转换。
+ */
+
+/* 每个像素的字节数，格式无效时返回 0 */
+static inline uint32_t upixel_bytes(int format) {
+	switch (format) {
+		case UTERM_FORMAT_RGBA8888:
+		case UTERM_FORMAT_XRGB8888:
+		case UTERM_FORMAT_BGRA8888:
+			return 4;
+		case UTERM_FORMAT_RGB565:
+			return 2;
+		default:
+			return 0;
+	}
+}
+
+/* 0xRRGGBBAA 换算到 format */
+static inline uint32_t upixel_from_rgba(int format, uint32_t rgba) {
+	uint32_t r = rgba >> 24, g = (rgba >> 16) & 0xFF, b = (rgba >> 8) & 0xFF, a = rgba & 0xFF;
+
+	switch (format) {
+		case UTERM_FORMAT_XRGB8888:
+			return rgba >> 8;
+		case UTERM_FORMAT_BGRA8888:
+			return (a << 24) | (rgba >> 8);
+		case UTERM_FORMAT_RGB565:
+			return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+		default:
+			return rgba;
+	}
+}
+
+/* format 换算回 0xRRGGBBAA，RGB565 的低位用高位补齐 */
+static inline uint32_t upixel_to_rgba(int format, uint32_t pixel) {
+	switch (format) {
+		case UTERM_FORMAT_XRGB8888:
+			return (pixel << 8) | 0xFF;
+		case UTERM_FORMAT_BGRA8888:
+			return (pixel << 8) | (pixel >> 24);
+		case UTERM_FORMAT_RGB565: {
+			uint32_t r = (pixel >> 11) & 0x1F, g = (pixel >> 5) & 0x3F, b = pixel & 0x1F;
+			r = (r << 3) | (r >> 2);
+			g = (g << 2) | (g >> 4);
+			b = (b << 3) | (b >> 2);
+			return (r << 24) | (g << 16) | (b << 8) | 0xFF;
+		}
+		default:
+			return pixel;
+	}
+}
+
+/* 从 dst 开始写 n 个相同的像素 */
+static inline void upixel_fill(uint8_t *dst, uint32_t n, uint32_t pixel, uint32_t bpp) {
+	if (bpp == 2) {
+		uint16_t *p = (uint16_t *) dst;
+		for (uint32_t i = 0; i < n; i++) p[i] = (uint16_t) pixel;
+	} else {
+		uint32_t *p = (uint32_t *) dst;
+		for (uint32_t i = 0; i < n; i++) p[i] = pixel;
+	}
+}
+
+#endif // INCLUDE_PIXEL_H_
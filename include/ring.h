@@ -0,0 +1,49 @@
+#ifndef INCLUDE_RING_H_
+#define INCLUDE_RING_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define URING_SIZE_DEFAULT 4096
+#define URING_SIZE_MIN 256
+
+/* 溢出策略，与 uterm.h 中的 UTERM_DROP_* 相同 */
+#define URING_DROP_OLDEST 0
+#define URING_DROP_NEWEST 1
+
+/*
+ * 多生产者单消费者字节环。每个槽位为 (圈数 << 8) | 字节，
+ * 消费者通过圈数判断槽位是否已写入、是否已被生产者覆盖。
+ *
+ * 生产者不加锁，也不等待消费者或被打断的其它生产者，可以在中断处理函数中
+ * 调用。这是无锁而不是免等待：CAS 只在另一个生产者成功时失败，单核上中断
+ * 处理函数的重试次数不超过嵌套中断的层数。免等待的丢新策略需要在预留后
+ * 撤销多出的部分，而之后的生产者可能已经预留，做不到。
+ */
+typedef struct uring
+{
+	uint32_t *slots;
+	uint32_t mask;          // 容量 - 1，容量为 2 的幂
+	uint32_t shift;         // log2(容量)
+	uint32_t lap_mask;      // 圈数的有效位
+	int policy;
+	uint32_t head;          // 消费者位置，生产者只读
+	uint32_t tail;          // 生产者预留的位置
+	uint32_t dropped;       // 丢弃的字节数，会回绕（32 位目标上的 64 位原子操作不是无锁的）
+} uring_t;
+
+/* size 向上取整为 2 的幂，失败返回 -1 */
+int uring_init(uring_t *ring, size_t size, int policy, void *(*malloc)(size_t));
+void uring_destroy(uring_t *ring, void (*free)(void*));
+
+/* 生产者：任意上下文可调用，从不阻塞。返回写入环中的字节数，环未建立时为 0 */
+size_t uring_write(uring_t *ring, const char *buf, size_t len);
+
+/* 消费者：同一时间只能有一个，返回读出的字节数 */
+size_t uring_read(uring_t *ring, char *buf, size_t max);
+
+static inline uint32_t uring_dropped(uring_t *ring) {
+	return __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+}
+
+#endif // INCLUDE_RING_H_
@@ -0,0 +1,39 @@
+#ifndef INCLUDE_SCAN_H_
+#define INCLUDE_SCAN_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 定义 USCAN_NO_SIMD 可关闭 SIMD 扫描内核
+#if !defined(USCAN_NO_SIMD) && (defined(__x86_64__) || defined(__i386__))
+#define USCAN_HAVE_X86 1
+#else
+#define USCAN_HAVE_X86 0
+#endif
+
+#if !defined(USCAN_NO_SIMD) && defined(__ARM_NEON) && defined(__aarch64__)
+#define USCAN_HAVE_NEON 1
+#else
+#define USCAN_HAVE_NEON 0
+#endif
+
+/* 返回 buf 开头可打印 ASCII（0x20-0x7E）的长度，即第一个控制字符、DEL 或 >= 0x80 字节的位置 */
+typedef size_t (*uscan_fn)(const uint8_t *buf, size_t len);
+
+/* 当前使用的扫描内核，由 uscan_select_kernel 选择 */
+extern uscan_fn uscan_kernel;
+
+static inline size_t uscan_printable(const uint8_t *buf, size_t len) {
+	return __atomic_load_n(&uscan_kernel, __ATOMIC_RELAXED)(buf, len);
+}
+
+/* 按 CPU 特性选择扫描内核（AVX2 > SSE2 > NEON > 标量），返回内核名称 */
+const char *uscan_select_kernel(void);
+
+/* 标量实现，供其它内核处理尾部 */
+size_t uscan_printable_c(const uint8_t *buf, size_t len);
+
+/* 编译进来的第 i 个内核（0 为标量），CPU 不支持时返回 NULL，i 超出范围时 *name 为 NULL；供测试逐个检查 */
+uscan_fn uscan_kernel_at(int i, const char **name);
+
+#endif // INCLUDE_SCAN_H_
@@ -0,0 +1,64 @@
+#ifndef INCLUDE_SCROLLBACK_H_
+#define INCLUDE_SCROLLBACK_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <buffer.h>
+
+#ifndef USCROLLBACK_DEFAULT
+#define USCROLLBACK_DEFAULT (256 * 1024) // 默认回滚缓冲预算（字节）
+#endif
+
+/*
+ * 每行记录：头部 + 属性段 + 字符。属性段为连续相同 fg/bg/attr 的单元，
+ * 行尾相同的空白单元不保存字符，由 fill 补齐。记录按 4 字节对齐。
+ */
+typedef struct uscrollback_line
+{
+	uint16_t chars;  // 保存的字符数
+	uint16_t spans;  // 属性段数，所有段覆盖整行
+	uint8_t wide;    // 字符为 4 字节，否则为 1 字节
+	uint8_t fill;    // chars 之后的单元的字符
+	uint8_t pad[2];
+} uscrollback_line_t;
+
+typedef struct uscrollback_span
+{
+	uint16_t count;
+	uint16_t attr;
+	uint32_t fg;
+	uint32_t bg;
+} uscrollback_span_t;
+
+#define USCROLLBACK_MIN_LINE (sizeof(uscrollback_line_t) + sizeof(uscrollback_span_t))
+
+/*
+ * 预分配的环形区域，放不下新行时淘汰最旧的行。
+ * lines 为每行记录在 arena 中的偏移，也是环形的。
+ */
+typedef struct uscrollback
+{
+	uint8_t *arena;
+	uint32_t arena_size;
+	uint32_t *lines;
+	uint32_t max_lines;
+	uint32_t first;   // 最旧的行在 lines 中的下标
+	uint32_t count;   // 已保存的行数
+	uint32_t tail;    // 下一条记录在 arena 中的偏移
+	uint32_t cols;
+} uscrollback_t;
+
+/* budget 为 arena 和索引的总字节数，0 表示关闭；失败返回 -1 */
+int uscrollback_init(uscrollback_t *sb, size_t budget, uint32_t cols, void *(*malloc)(size_t));
+void uscrollback_destroy(uscrollback_t *sb, void (*free)(void*));
+
+/* 清空所有行，保留内存 */
+void uscrollback_clear(uscrollback_t *sb);
+
+/* 保存一行 cols 个单元，不分配内存 */
+void uscrollback_push(uscrollback_t *sb, const ucell_t *cells);
+
+/* 取出第 index 行（0 为最旧的行）到 cells，越界返回 -1 */
+int uscrollback_get(const uscrollback_t *sb, uint32_t index, ucell_t *cells);
+
+#endif // INCLUDE_SCROLLBACK_H_
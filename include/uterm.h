@@ -7,12 +7,50 @@
 
 typedef long ssize_t;
 
+/*
+ * Terminal context. Every uterm_ctx_* function works on its own context,
+ * different contexts can be driven by different threads at the same time.
+ * The functions without a context work on the default instance created by
+ * init_uterm.
+ */
+typedef struct uterm uterm_t;
+
+/*
+ * Counters kept when built with -DUTERM_STATS. Times are in the units of the
+ * clock given to uterm_set_clock, 0 without a clock.
+ */
+typedef struct uterm_stats
+{
+	uint64_t bytes;          // Bytes written to the terminal
+	uint64_t glyphs;         // Cells rasterized from glyphs into the back buffer
+	uint64_t back_pixels;    // Pixels rasterized into the back buffer (glyphs and fills)
+	uint64_t front_pixels;   // Pixels written to the front buffer (vram)
+	uint64_t scrolls;
+	uint64_t flushes;
+	uint64_t escapes[128];   // Escape sequences parsed, by final byte
+	uint64_t parse_time;     // In uterm_write/uterm_putc
+	uint64_t render_time;    // Rasterizing at flush
+	uint64_t present_time;   // Copying to vram at flush
+	uint64_t moved_pixels;   // Back buffer pixels moved by region scrolls and IL/DL/ICH/DCH
+	uint64_t fills;          // Blank cells filled with their color instead of a glyph
+} uterm_stats_t;
+
+/* Input ring overflow policy */
+#define UTERM_DROP_OLDEST 0
+#define UTERM_DROP_NEWEST 1
+
+/* Pixel formats of vram, see uterm_set_format */
+#define UTERM_FORMAT_RGBA8888 0 // 32 bit 0xRRGGBBAA (default)
+#define UTERM_FORMAT_XRGB8888 1 // 32 bit 0x00RRGGBB
+#define UTERM_FORMAT_BGRA8888 2 // 32 bit 0xAARRGGBB, bytes B, G, R, A in little endian
+#define UTERM_FORMAT_RGB565   3 // 16 bit
+
 /*
  * @brief FUNCTION DISCRIPTION: Initialize uterm.
  * @param *vram Video memory address. (Frame Buffer)
  * @param width Framebuffer width
  * @param height Framebuffer height
- * @param font[] ASCII font (8x16). Use embedded font if 0. @todo
+ * The embedded CP437 font (8x16) is used, see uterm_set_font.
  * @param malloc System given.
  * @param free System given.
  */
@@ -28,12 +66,245 @@ void uterm_putc(char ch);
 
 void uterm_puts(char *s);
 
+/*
+ * @brief FUNCTION DISCRIPTION: Write a buffer to the terminal.
+ * Printable runs are written into the cell row at once.
+ * Input is UTF-8; a sequence may be split across calls. East Asian wide
+ * characters take two cells, invalid bytes show as U+FFFD.
+ * SGR colors: 16 colors, 256 colors (38;5;n) and 24 bit (38;2;r;g;b),
+ * also in the ':' separated form.
+ * CSI: CUU CUD CUF CUB CNL CPL CHA HPA HPR VPA VPR CUP HVP ED EL ECH ICH DCH
+ * IL DL SU SD DECSTBM SGR SCOSC SCORC DECTCEM. ESC: DECSC DECRC IND NEL RI RIS.
+ * OSC and DCS strings are consumed and ignored.
+ * @param *buf Data, not need to be NUL-terminated.
+ * @param len Length of data.
+ */
+void uterm_write(const char *buf, size_t len);
+
+/*
+ * @brief FUNCTION DISCRIPTION: Show or hide the cursor.
+ * The cursor is only drawn over the front buffer in uterm_flush,
+ * the cell under it in the back buffer is never touched.
+ * @param show 1 to show, 0 to hide.
+ */
 void uterm_show_cursor(int show);
 
+/*
+ * @brief FUNCTION DISCRIPTION: Use a PSF2 font.
+ * Glyphs are read from psf directly, it must stay valid until another font
+ * is set or the terminal is destroyed. Glyphs of other sizes than the cell
+ * are scaled when drawn. Without a Unicode table, code point i is glyph i.
+ * @param *psf PSF2 data, 0 for the embedded font.
+ * @param size Bytes of psf.
+ * @return 0 on success, -1 if the data is not a valid PSF2 font.
+ */
+int uterm_set_font(const void *psf, size_t size);
+
+/*
+ * @brief FUNCTION DISCRIPTION: Map a PSF2 font file and use it.
+ * The file is unmapped when replaced or on destroy.
+ * @param *path File path.
+ * @return 0 on success, -1 on failure or if built without UTERM_MMAP.
+ */
+int uterm_load_font(const char *path);
+
+/*
+ * @brief FUNCTION DISCRIPTION: Set the pixel format of vram.
+ * Pixels are drawn in this format directly, vram and pages hold
+ * width * height pixels of it. RGB565 halves the memory of the back buffer.
+ * Colors passed to uterm_draw_pix and uterm_cell_putc_raw stay RGBA.
+ * The screen is redrawn and the scrollback is cleared.
+ * @param format UTERM_FORMAT_*.
+ * @return 0 on success, -1 if the format is unknown or out of memory.
+ */
+int uterm_set_format(int format);
+
+/*
+ * @brief FUNCTION DISCRIPTION: Set the memory budget of the glyph tile cache.
+ * Expanded (glyph, fg, bg) tiles are cached, the old tiles are dropped.
+ * @param budget Bytes, the cache is disabled if too small for one set.
+ */
+void uterm_set_glyph_cache(size_t budget);
+
+/*
+ * @brief FUNCTION DISCRIPTION: Get the glyph tile cache counters.
+ * @param *hits Cache hits, may be 0.
+ * @param *misses Cache misses, may be 0.
+ */
+void uterm_glyph_cache_stats(uint64_t *hits, uint64_t *misses);
+
+/*
+ * @brief FUNCTION DISCRIPTION: Rasterize damaged rows with worker threads in uterm_flush.
+ * Rows are split into bands, one per thread, the glyph cache budget is
+ * shared between the threads.
+ * @param workers Extra threads besides the caller, 0 for single-thread.
+ * @param spawn Host given, runs entry(arg) on a new thread, returns 0 on success.
+ * Use pthreads if 0 (hosted builds only).
+ * @return 0 on success, -1 if the threads can not be created.
+ */
+int uterm_set_workers(int workers, int (*spawn)(void (*entry)(void *), void *arg));
+
+/*
+ * @brief FUNCTION DISCRIPTION: Resize the input ring used by uterm_enqueue.
+ * Must not race with uterm_enqueue. On failure the old ring is kept.
+ * @param size Ring size in bytes, rounded up to a power of two (default 4096).
+ * @param policy UTERM_DROP_OLDEST or UTERM_DROP_NEWEST when the ring is full.
+ * @return 0 on success, -1 on failure.
+ */
+int uterm_set_input_ring(size_t size, int policy);
+
+/*
+ * @brief FUNCTION DISCRIPTION: Queue bytes without parsing or rendering.
+ * Lock-free (not wait-free with UTERM_DROP_NEWEST: a producer retries only
+ * when another producer succeeded), safe from any thread or interrupt handler.
+ * @return Bytes stored in the ring, less than len when bytes were dropped.
+ */
+size_t uterm_enqueue(const char *buf, size_t len);
+
+/*
+ * @brief FUNCTION DISCRIPTION: Process queued bytes and flush the screen.
+ * @param budget Max bytes to process, 0 for everything queued.
+ * @return Bytes processed.
+ */
+size_t uterm_drain(size_t budget);
+
+/*
+ * @brief FUNCTION DISCRIPTION: Bytes dropped because the input ring was full.
+ * The count wraps around at 2^32.
+ */
+uint32_t uterm_input_dropped(void);
+
+/*
+ * @brief FUNCTION DISCRIPTION: Set the scrollback memory budget and clear the history.
+ * Lines scrolled off the top are kept until the budget is used up, then the
+ * oldest lines are dropped. The memory is allocated here, not while scrolling.
+ * @param budget Bytes, 0 to disable (default 256 KiB).
+ * @return 0 on success, -1 on failure.
+ */
+int uterm_set_scrollback(size_t budget);
+
+/*
+ * @brief FUNCTION DISCRIPTION: Number of lines in the scrollback.
+ */
+uint32_t uterm_scrollback_lines(void);
+
+/*
+ * @brief FUNCTION DISCRIPTION: Show the screen scrolled back by some lines.
+ * Renders history lines and the top of the live screen into the framebuffer.
+ * The next uterm_flush returns to the live screen.
+ * @param lines Lines to scroll back, clamped to uterm_scrollback_lines. 0 for the live screen.
+ */
+void uterm_view_history(uint32_t lines);
+
+/*
+ * @brief FUNCTION DISCRIPTION: Present through two scanout buffers instead of copying into vram.
+ * uterm_flush copies into the hidden page only the cells changed since that
+ * page was last shown, then calls present(page) to flip to it.
+ * @param *page0 The page being scanned out now.
+ * @param *page1 The other page, 0 to go back to a single vram (page0).
+ * @param present Host given, shows page 0 or 1. Must not return until the flip
+ * has taken effect (e.g. wait for the KMS page-flip event or vsync): the next
+ * flush draws into the page that was shown before, and an asynchronous flip
+ * would show it half drawn.
+ * @return 0 on success, -1 on failure.
+ */
+int uterm_set_pages(uint32_t *page0, uint32_t *page1, void (*present)(int page));
+
+/*
+ * @brief FUNCTION DISCRIPTION: Report the framebuffer rectangles changed by uterm_flush.
+ * Called once per changed run of cells, in pixels. The pixels are final when
+ * uterm_flush returns.
+ * @param damage Host given, 0 to disable.
+ */
+void uterm_set_damage_callback(void (*damage)(int x, int y, int w, int h));
+
+/*
+ * @brief FUNCTION DISCRIPTION: Get the counters of the default instance.
+ * @param *stats Filled with the counters, zeroed if statistics are compiled out.
+ * @return 0 on success, -1 if built without UTERM_STATS.
+ */
+int uterm_get_stats(uterm_stats_t *stats);
+
+void uterm_reset_stats(void);
+
+/*
+ * @brief FUNCTION DISCRIPTION: Set the clock used for the time counters.
+ * @param clock Host given, monotonic, any unit. 0 to stop timing.
+ */
+void uterm_set_clock(uint64_t (*clock)(void));
+
 void uterm_destroy(void);
 
 void uterm_scroll(void);
 
 void uterm_flush(void);
 
+/*
+ * @brief FUNCTION DISCRIPTION: Create a terminal context.
+ * Parameters are the same as init_uterm.
+ * @return The context, destroy it with uterm_ctx_destroy.
+ */
+uterm_t *uterm_ctx_create(uint32_t *vram, ssize_t width, ssize_t height, void *(*malloc)(size_t), void (*free)(void*));
+
+/*
+ * @brief FUNCTION DISCRIPTION: Get the default instance created by init_uterm.
+ */
+uterm_t *uterm_default(void);
+
+void uterm_ctx_draw_pix(uterm_t *ut, int x, int y, uint32_t rgba);
+
+void uterm_ctx_cell_putc_raw(uterm_t *ut, char ch, int cellx, int celly, uint32_t rgbaF, uint32_t rgbaB);
+
+void uterm_ctx_cell_putc(uterm_t *ut, char ch, int cellx, int celly);
+
+void uterm_ctx_putc(uterm_t *ut, char ch);
+
+void uterm_ctx_puts(uterm_t *ut, char *s);
+
+void uterm_ctx_write(uterm_t *ut, const char *buf, size_t len);
+
+void uterm_ctx_show_cursor(uterm_t *ut, int show);
+
+int uterm_ctx_set_font(uterm_t *ut, const void *psf, size_t size);
+
+int uterm_ctx_load_font(uterm_t *ut, const char *path);
+
+int uterm_ctx_set_format(uterm_t *ut, int format);
+
+void uterm_ctx_set_glyph_cache(uterm_t *ut, size_t budget);
+
+void uterm_ctx_glyph_cache_stats(uterm_t *ut, uint64_t *hits, uint64_t *misses);
+
+int uterm_ctx_set_workers(uterm_t *ut, int workers, int (*spawn)(void (*entry)(void *), void *arg));
+
+int uterm_ctx_set_input_ring(uterm_t *ut, size_t size, int policy);
+
+size_t uterm_ctx_enqueue(uterm_t *ut, const char *buf, size_t len);
+
+size_t uterm_ctx_drain(uterm_t *ut, size_t budget);
+
+uint32_t uterm_ctx_input_dropped(uterm_t *ut);
+
+int uterm_ctx_set_scrollback(uterm_t *ut, size_t budget);
+
+uint32_t uterm_ctx_scrollback_lines(uterm_t *ut);
+
+void uterm_ctx_view_history(uterm_t *ut, uint32_t lines);
+
+int uterm_ctx_set_pages(uterm_t *ut, uint32_t *page0, uint32_t *page1, void (*present)(int page));
+
+void uterm_ctx_set_damage_callback(uterm_t *ut, void (*damage)(int x, int y, int w, int h));
+
+int uterm_ctx_get_stats(uterm_t *ut, uterm_stats_t *stats);
+
+void uterm_ctx_reset_stats(uterm_t *ut);
+
+void uterm_ctx_set_clock(uterm_t *ut, uint64_t (*clock)(void));
+
+void uterm_ctx_destroy(uterm_t *ut);
+
+void uterm_ctx_scroll(uterm_t *ut);
+
+void uterm_ctx_flush(uterm_t *ut);
+
 #endif // INCLUDE_UTERM_H_
@@ -0,0 +1,59 @@
+#ifndef INCLUDE_VTPARSE_H_
+#define INCLUDE_VTPARSE_H_
+
+#include <stdint.h>
+
+/*
+ * DEC/ECMA-48 解析器的状态和动作（参照 VT500 系列的状态图）。
+ * 状态从 1 开始，转换表中的 0 表示状态不变。
+ */
+enum uvt_state {
+	UVT_GROUND = 1,
+	UVT_ESCAPE,
+	UVT_ESCAPE_INTERMEDIATE,
+	UVT_CSI_ENTRY,
+	UVT_CSI_PARAM,
+	UVT_CSI_INTERMEDIATE,
+	UVT_CSI_IGNORE,
+	UVT_DCS_ENTRY,
+	UVT_DCS_PARAM,
+	UVT_DCS_INTERMEDIATE,
+	UVT_DCS_PASSTHROUGH,
+	UVT_DCS_IGNORE,
+	UVT_OSC_STRING,
+	UVT_SOS_PM_APC_STRING,
+	UVT_STATE_COUNT
+};
+
+enum uvt_action {
+	UVT_NONE = 0,
+	UVT_PRINT,
+	UVT_EXECUTE,
+	UVT_CLEAR,
+	UVT_COLLECT,
+	UVT_PARAM,
+	UVT_ESC_DISPATCH,
+	UVT_CSI_DISPATCH,
+	UVT_HOOK,
+	UVT_PUT,
+	UVT_UNHOOK,
+	UVT_OSC_START,
+	UVT_OSC_PUT,
+	UVT_OSC_END,
+	UVT_IGNORE
+};
+
+#define UVT_MAX_PARAMS 32 // 不超过 param_sub 的位数
+#define UVT_MAX_INTERMEDIATES 2
+#define UVT_MAX_PARAM_VALUE 65535
+#define UVT_OSC_MAX 64
+
+/* 转换表项：高 4 位为动作，低 4 位为下一个状态 */
+#define UVT_ACTION(t) ((t) >> 4)
+#define UVT_NEXT(t) ((t) & 0x0F)
+
+extern const uint8_t uvt_table[UVT_STATE_COUNT][256];
+extern const uint8_t uvt_entry_action[UVT_STATE_COUNT]; // 进入状态时的动作
+extern const uint8_t uvt_exit_action[UVT_STATE_COUNT];  // 离开状态时的动作
+
+#endif // INCLUDE_VTPARSE_H_
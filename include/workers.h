@@ -0,0 +1,55 @@
+#ifndef INCLUDE_WORKERS_H_
+#define INCLUDE_WORKERS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef UTERM_PTHREADS
+#include <pthread.h>
+#endif
+
+/* 任务函数，band 为 0 时在调用 uworker_pool_run 的线程中执行 */
+typedef void (*uworker_job_fn)(void *arg, int band);
+
+/* 宿主提供的线程创建接口：在新线程中运行 entry(arg)，成功返回 0 */
+typedef int (*uworker_spawn_fn)(void (*entry)(void *), void *arg);
+
+struct uworker_pool;
+
+typedef struct uworker_slot
+{
+	struct uworker_pool *pool;
+	int band;
+} uworker_slot_t;
+
+/*
+ * 固定数量的工作线程。使用 pthreads 时空闲线程在条件变量上睡眠；
+ * 使用宿主线程时空闲线程自旋等待（裸机上每个核一个线程）。
+ */
+typedef struct uworker_pool
+{
+	int nworkers;           // 工作线程数，不含调用线程
+	uint32_t generation;    // 每分派一次任务加一
+	uint32_t pending;       // 尚未完成当前任务的工作线程数
+	uint32_t alive;         // 尚未退出的工作线程数
+	int stop;
+	uworker_job_fn job;
+	void *job_arg;
+	uworker_slot_t *slots;
+#ifdef UTERM_PTHREADS
+	int use_pthreads;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	pthread_t *threads;
+#endif
+} uworker_pool_t;
+
+/* spawn 为 0 时使用 pthreads（仅限定义了 UTERM_PTHREADS 的构建），失败返回 -1 */
+int uworker_pool_start(uworker_pool_t *pool, int nworkers, uworker_spawn_fn spawn, void *(*malloc)(size_t), void (*free)(void*));
+
+/* 在调用线程和所有工作线程上运行 job，返回时全部完成 */
+void uworker_pool_run(uworker_pool_t *pool, uworker_job_fn job, void *arg);
+
+void uworker_pool_stop(uworker_pool_t *pool, void (*free)(void*));
+
+#endif // INCLUDE_WORKERS_H_
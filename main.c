@@ -1,5 +1,10 @@
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <poll.h>
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -9,31 +14,159 @@
 #define WIDTH  800
 #define HEIGHT 600
 
+#define MAX_RECTS 64
+
 uint32_t framebuffer[WIDTH * HEIGHT];
 
-// void draw_pixel(int x, int y, uint32_t color) {
-//     if (x >= 0 && x < WIDTH && y >= 0 && y < HEIGHT) {
-//         framebuffer[y * WIDTH + x] = color;
-//     }
-// }
+typedef struct rect
+{
+    int x, y, w, h;
+} rect_t;
+
+// 等待提交到 X 服务器的损坏区域
+static rect_t rects[MAX_RECTS];
+static int rect_count = 0;
+
+static Display *display;
+static Window window;
+static GC gc;
+static XImage *ximage;
+static XShmSegmentInfo shminfo;
+static int use_shm = 0;
+static int put_pending = 0; // XShmPutImage 未完成时不能改写共享内存
+
+// uterm 报告的损坏矩形，同一列的相邻矩形合并
+static void on_damage(int x, int y, int w, int h) {
+    for (int i = rect_count - 1; i >= 0 && i >= rect_count - 4; i--) {
+        rect_t *r = &rects[i];
+        if (r->x == x && r->w == w && r->y + r->h == y) {
+            r->h += h;
+            return;
+        }
+        if (r->y == y && r->h == h && r->x + r->w == x) {
+            r->w += w;
+            return;
+        }
+    }
+
+    if (rect_count == MAX_RECTS) { // 太多时合并为一个包围盒
+        rect_t *r = &rects[0];
+        for (int i = 1; i < rect_count; i++) {
+            int x1 = rects[i].x + rects[i].w > r->x + r->w ? rects[i].x + rects[i].w : r->x + r->w;
+            int y1 = rects[i].y + rects[i].h > r->y + r->h ? rects[i].y + rects[i].h : r->y + r->h;
+            if (rects[i].x < r->x) r->x = rects[i].x;
+            if (rects[i].y < r->y) r->y = rects[i].y;
+            r->w = x1 - r->x;
+            r->h = y1 - r->y;
+        }
+        rect_count = 1;
+        on_damage(x, y, w, h);
+        return;
+    }
+
+    rects[rect_count++] = (rect_t) { x, y, w, h };
+}
+
+// 把帧缓冲中的矩形复制到图像。帧缓冲已是 X 的 XRGB8888，不需要换算；
+// 图像的行距由 X 决定，不一定是 WIDTH * 4
+static void copy_rect(const rect_t *r) {
+    for (int y = r->y; y < r->y + r->h; y++) {
+        char *dst = ximage->data + (size_t) y * ximage->bytes_per_line + r->x * sizeof(uint32_t);
+        memcpy(dst, &framebuffer[y * WIDTH + r->x], r->w * sizeof(uint32_t));
+    }
+}
+
+// 只提交损坏的矩形，使用共享内存时每次等待上一次完成
+static void present(void) {
+    if (rect_count == 0 || put_pending) return;
+
+    for (int i = 0; i < rect_count; i++) {
+        rect_t *r = &rects[i];
+        copy_rect(r);
+        if (use_shm) {
+            XShmPutImage(display, window, gc, ximage, r->x, r->y, r->x, r->y, r->w, r->h, i == rect_count - 1);
+        } else {
+            XPutImage(display, window, gc, ximage, r->x, r->y, r->x, r->y, r->w, r->h);
+        }
+    }
+    put_pending = use_shm;
+    rect_count = 0;
+    XFlush(display);
+}
+
+static int shm_error = 0;
+
+static int on_shm_error(Display *d, XErrorEvent *e) {
+    (void) d;
+    (void) e;
+    shm_error = 1;
+    return 0;
+}
+
+// 任何一步失败都释放已分配的部分并返回 -1，由调用者退回 XPutImage
+static int create_shm_image(Visual *visual, int depth) {
+    ximage = XShmCreateImage(display, visual, depth, ZPixmap, NULL, &shminfo, WIDTH, HEIGHT);
+    if (!ximage) return -1;
+
+    shminfo.shmid = shmget(IPC_PRIVATE, ximage->bytes_per_line * ximage->height, IPC_CREAT | 0600);
+    if (shminfo.shmid < 0) goto fail_image;
+    shminfo.shmaddr = shmat(shminfo.shmid, NULL, 0);
+    if (shminfo.shmaddr == (char *) -1) goto fail_segment;
+    ximage->data = shminfo.shmaddr;
+    shminfo.readOnly = False;
+
+    // 远程显示也可能报告支持 MIT-SHM，附加失败时默认的错误处理会退出进程
+    XSync(display, False);
+    shm_error = 0;
+    int (*old_handler)(Display *, XErrorEvent *) = XSetErrorHandler(on_shm_error);
+    Status attached = XShmAttach(display, &shminfo);
+    XSync(display, False);
+    XSetErrorHandler(old_handler);
+    if (!attached || shm_error) goto fail_attach;
+
+    shmctl(shminfo.shmid, IPC_RMID, NULL); // 双方分离后自动释放
+    return 0;
+
+fail_attach:
+    shmdt(shminfo.shmaddr);
+    ximage->data = NULL;
+fail_segment:
+    shmctl(shminfo.shmid, IPC_RMID, NULL);
+fail_image:
+    XDestroyImage(ximage);
+    ximage = NULL;
+    return -1;
+}
+
+static int create_image(int screen) {
+    Visual *visual = DefaultVisual(display, screen);
+    int depth = DefaultDepth(display, screen);
+
+    if (XShmQueryExtension(display) && create_shm_image(visual, depth) == 0) {
+        use_shm = 1;
+        return 0;
+    }
 
-// void draw_rect(int x, int y, int w, int h, uint32_t color) {
-//     for (int dy = 0; dy < h; dy++) {
-//         for (int dx = 0; dx < w; dx++) {
-//             draw_pixel(x + dx, y + dy, color);
-//         }
-//     }
-// }
+    // 不支持 MIT-SHM 或附加失败时退回 XPutImage
+    char *data = malloc(WIDTH * HEIGHT * 4);
+    if (!data) return -1;
+    ximage = XCreateImage(display, visual, depth, ZPixmap, 0, data, WIDTH, HEIGHT, 32, WIDTH * 4);
+    if (!ximage) {
+        free(data);
+        return -1;
+    }
+    return 0;
+}
 
 int main() {
-    Display* display = XOpenDisplay(NULL);
+    display = XOpenDisplay(NULL);
     if (!display) {
         fprintf(stderr, "无法打开X显示\n");
         return 1;
     }
 
     int screen = DefaultScreen(display);
-    Window window = XCreateSimpleWindow(
+    window = XCreateSimpleWindow(
         display, RootWindow(display, screen),
         0, 0, WIDTH, HEIGHT, 1,
         BlackPixel(display, screen),
@@ -43,71 +176,69 @@ int main() {
     XSelectInput(display, window, ExposureMask);
     XMapWindow(display, window);
 
-    // 创建图像缓冲区
-    XImage* ximage = XCreateImage(
-        display, DefaultVisual(display, screen),
-        DefaultDepth(display, screen),
-        ZPixmap, 0,
-        (char*)framebuffer, WIDTH, HEIGHT,
-        32, WIDTH * 4
-    );
-
-    // 设置正确的字节序
-    ximage->byte_order = MSBFirst;
-    ximage->bitmap_bit_order = MSBFirst;
-
-    GC gc = XCreateGC(display, window, 0, NULL);
+    if (create_image(screen) != 0) {
+        fprintf(stderr, "无法创建图像\n");
+        return 1;
+    }
+    int completion = XShmGetEventBase(display) + ShmCompletion;
 
-    // 初始化framebuffer为白色
-    memset(framebuffer, 0xffffffff, sizeof(framebuffer));
-    framebuffer[10 + 10 * WIDTH] = 0x000000;
+    gc = XCreateGC(display, window, 0, NULL);
 
     init_uterm(framebuffer, WIDTH, HEIGHT, malloc, free);
-    
-    // uterm_putc('A');
-    // uterm_flush();
-    // for (int i = 0; i < WIDTH / 8 * HEIGHT / 16 - 300; i++){
-    //     uterm_putc('A');
-    //     uterm_flush();
-    // }
-
-    uterm_putc('H');
-    uterm_putc(' ');
-    uterm_flush();
+    uterm_set_format(UTERM_FORMAT_XRGB8888); // 与 X 服务器的像素格式相同，提交时不再换算
+    uterm_set_damage_callback(on_damage);
 
     uterm_puts("Hello world");
     uterm_puts("\033[31mHello \033[44mWorld\033[0m\n");
+    uterm_puts("UTERM by Rainy101112.\n");
     uterm_flush();
 
-    uterm_puts("UTERM by Rainy101112.");
-    uterm_flush();
+    // 事件循环：等待 X 事件或标准输入，没有输入时不占用 CPU
+    struct pollfd fds[2] = {
+        { .fd = ConnectionNumber(display), .events = POLLIN },
+        { .fd = STDIN_FILENO, .events = POLLIN },
+    };
+    int nfds = 2;
 
-    // 事件循环
     while (1) {
-        XEvent event;
-        if (XPending(display)) {
+        XFlush(display);
+        if (!XPending(display) && poll(fds, nfds, -1) < 0) {
+            if (errno == EINTR) continue; // 被信号打断（SIGWINCH、SIGCHLD 等），重新等待
+            break;
+        }
+
+        while (XPending(display)) {
+            XEvent event;
             XNextEvent(display, &event);
             if (event.type == Expose) {
-                XPutImage(
-                    display, window, gc, ximage,
-                    0, 0, 0, 0,
-                    WIDTH, HEIGHT
-                );
+                on_damage(0, 0, WIDTH, HEIGHT);
+            } else if (use_shm && event.type == completion) {
+                put_pending = 0;
             }
         }
 
-        // 更新显示
-        XPutImage(
-            display, window, gc, ximage,
-            0, 0, 0, 0,
-            WIDTH, HEIGHT
-        );
-        
-        usleep(10000);  // 简单帧率控制
+        if (nfds > 1 && (fds[1].revents & (POLLIN | POLLHUP))) {
+            char buf[4096];
+            ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+            if (n > 0) {
+                uterm_write(buf, n);
+                uterm_flush();
+            } else {
+                nfds = 1; // 标准输入已关闭
+            }
+        }
+        fds[1].revents = 0;
+
+        present();
     }
 
     uterm_destroy();
+    if (use_shm) {
+        XShmDetach(display, &shminfo);
+        shmdt(shminfo.shmaddr);
+        ximage->data = NULL; // 共享内存已分离，不能由 XDestroyImage 释放
+    }
     XDestroyImage(ximage);
     XCloseDisplay(display);
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,126 @@
+#include <stdint.h>
+#include <uterm.h>
+
+/* 旧接口：对默认实例的简单封装 */
+static uterm_t *default_term = NULL;
+
+uterm_t *uterm_default(void) {
+	return default_term;
+}
+
+void init_uterm(uint32_t *vram, ssize_t width, ssize_t height, void *(*malloc)(size_t), void (*free)(void*)) {
+	default_term = uterm_ctx_create(vram, width, height, malloc, free);
+}
+
+void uterm_draw_pix(int x, int y, uint32_t rgba) {
+	uterm_ctx_draw_pix(default_term, x, y, rgba);
+}
+
+void uterm_cell_putc_raw(char ch, int cellx, int celly, uint32_t rgbaF, uint32_t rgbaB) {
+	uterm_ctx_cell_putc_raw(default_term, ch, cellx, celly, rgbaF, rgbaB);
+}
+
+void uterm_cell_putc(char ch, int cellx, int celly) {
+	uterm_ctx_cell_putc(default_term, ch, cellx, celly);
+}
+
+void uterm_putc(char ch) {
+	uterm_ctx_putc(default_term, ch);
+}
+
+void uterm_puts(char *s) {
+	uterm_ctx_puts(default_term, s);
+}
+
+void uterm_write(const char *buf, size_t len) {
+	uterm_ctx_write(default_term, buf, len);
+}
+
+void uterm_show_cursor(int show) {
+	uterm_ctx_show_cursor(default_term, show);
+}
+
+int uterm_set_font(const void *psf, size_t size) {
+	return uterm_ctx_set_font(default_term, psf, size);
+}
+
+int uterm_load_font(const char *path) {
+	return uterm_ctx_load_font(default_term, path);
+}
+
+int uterm_set_format(int format) {
+	return uterm_ctx_set_format(default_term, format);
+}
+
+void uterm_set_glyph_cache(size_t budget) {
+	uterm_ctx_set_glyph_cache(default_term, budget);
+}
+
+void uterm_glyph_cache_stats(uint64_t *hits, uint64_t *misses) {
+	uterm_ctx_glyph_cache_stats(default_term, hits, misses);
+}
+
+int uterm_set_workers(int workers, int (*spawn)(void (*entry)(void *), void *arg)) {
+	return uterm_ctx_set_workers(default_term, workers, spawn);
+}
+
+int uterm_set_input_ring(size_t size, int policy) {
+	return uterm_ctx_set_input_ring(default_term, size, policy);
+}
+
+size_t uterm_enqueue(const char *buf, size_t len) {
+	return uterm_ctx_enqueue(default_term, buf, len);
+}
+
+size_t uterm_drain(size_t budget) {
+	return uterm_ctx_drain(default_term, budget);
+}
+
+uint32_t uterm_input_dropped(void) {
+	return uterm_ctx_input_dropped(default_term);
+}
+
+int uterm_set_scrollback(size_t budget) {
+	return uterm_ctx_set_scrollback(default_term, budget);
+}
+
+uint32_t uterm_scrollback_lines(void) {
+	return uterm_ctx_scrollback_lines(default_term);
+}
+
+void uterm_view_history(uint32_t lines) {
+	uterm_ctx_view_history(default_term, lines);
+}
+
+int uterm_set_pages(uint32_t *page0, uint32_t *page1, void (*present)(int page)) {
+	return uterm_ctx_set_pages(default_term, page0, page1, present);
+}
+
+void uterm_set_damage_callback(void (*damage)(int x, int y, int w, int h)) {
+	uterm_ctx_set_damage_callback(default_term, damage);
+}
+
+int uterm_get_stats(uterm_stats_t *stats) {
+	return uterm_ctx_get_stats(default_term, stats);
+}
+
+void uterm_reset_stats(void) {
+	uterm_ctx_reset_stats(default_term);
+}
+
+void uterm_set_clock(uint64_t (*clock)(void)) {
+	uterm_ctx_set_clock(default_term, clock);
+}
+
+void uterm_destroy(void) {
+	uterm_ctx_destroy(default_term);
+	default_term = NULL;
+}
+
+void uterm_scroll(void) {
+	uterm_ctx_scroll(default_term);
+}
+
+void uterm_flush(void) {
+	uterm_ctx_flush(default_term);
+}
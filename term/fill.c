@@ -0,0 +1,77 @@
+#include <stdint.h>
+#include <string.h>
+#include <fill.h>
+
+#if UFILL_HAVE_X86
+#include <immintrin.h>
+#endif
+
+void ufill_rect_c(uint8_t *dst, size_t pitch, size_t bytes, uint32_t rows, uint32_t pattern) {
+	for (uint32_t y = 0; y < rows; y++, dst += pitch) {
+		uint8_t *p = dst;
+		for (size_t i = 0; i < bytes; i += 4, p += 4) memcpy(p, &pattern, 4);
+	}
+}
+
+#if UFILL_HAVE_X86
+/* 每行先用 64 字节一组的宽存储，剩下的不足 16 字节由标量补齐 */
+__attribute__((target("sse2")))
+static void ufill_rect_sse2(uint8_t *dst, size_t pitch, size_t bytes, uint32_t rows, uint32_t pattern) {
+	const __m128i v = _mm_set1_epi32(pattern);
+
+	for (uint32_t y = 0; y < rows; y++, dst += pitch) {
+		size_t i = 0;
+		for (; i + 64 <= bytes; i += 64) {
+			_mm_storeu_si128((__m128i *) (dst + i), v);
+			_mm_storeu_si128((__m128i *) (dst + i + 16), v);
+			_mm_storeu_si128((__m128i *) (dst + i + 32), v);
+			_mm_storeu_si128((__m128i *) (dst + i + 48), v);
+		}
+		for (; i + 16 <= bytes; i += 16) _mm_storeu_si128((__m128i *) (dst + i), v);
+		if (i < bytes) ufill_rect_c(dst + i, pitch, bytes - i, 1, pattern);
+	}
+}
+
+__attribute__((target("avx2")))
+static void ufill_rect_avx2(uint8_t *dst, size_t pitch, size_t bytes, uint32_t rows, uint32_t pattern) {
+	const __m256i v = _mm256_set1_epi32(pattern);
+
+	for (uint32_t y = 0; y < rows; y++, dst += pitch) {
+		size_t i = 0;
+		for (; i + 128 <= bytes; i += 128) {
+			_mm256_storeu_si256((__m256i *) (dst + i), v);
+			_mm256_storeu_si256((__m256i *) (dst + i + 32), v);
+			_mm256_storeu_si256((__m256i *) (dst + i + 64), v);
+			_mm256_storeu_si256((__m256i *) (dst + i + 96), v);
+		}
+		for (; i + 32 <= bytes; i += 32) _mm256_storeu_si256((__m256i *) (dst + i), v);
+		if (i + 16 <= bytes) {
+			_mm_storeu_si128((__m128i *) (dst + i), _mm256_castsi256_si128(v));
+			i += 16;
+		}
+		if (i < bytes) ufill_rect_c(dst + i, pitch, bytes - i, 1, pattern);
+	}
+}
+#endif
+
+ufill_fn ufill_kernel = ufill_rect_c;
+
+const char *ufill_select_kernel() {
+#if UFILL_HAVE_X86
+	ufill_fn fn = ufill_rect_c;
+	const char *name = "c";
+
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		fn = ufill_rect_avx2;
+		name = "avx2";
+	} else if (__builtin_cpu_supports("sse2")) {
+		fn = ufill_rect_sse2;
+		name = "sse2";
+	}
+	__atomic_store_n(&ufill_kernel, fn, __ATOMIC_RELAXED);
+	return name;
+#else
+	return "c";
+#endif
+}
@@ -0,0 +1,138 @@
+#include <stdint.h>
+#include <string.h>
+#include <font.h>
+#include <glyphmap.h>
+
+#ifdef UTERM_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+void ufont_raw(ufont_t *font, const uint8_t *glyphs, uint32_t count, uint32_t width, uint32_t height) {
+	memset(font, 0, sizeof(ufont_t));
+	font->glyphs = glyphs;
+	font->count = count;
+	font->width = width;
+	font->height = height;
+	font->row_bytes = (width + 7) / 8;
+	font->bytes = font->row_bytes * height;
+	font->native = font->row_bytes == UGLYPH_ROW_BYTES && height == UGLYPH_HEIGHT;
+}
+
+/* 只检查头部和长度，不读取字形和 Unicode 表。PSF2 为小端 */
+int ufont_psf2(ufont_t *font, const void *data, size_t size) {
+	ufont_psf2_header_t h;
+
+	if (size < sizeof(h)) return -1;
+	memcpy(&h, data, sizeof(h));
+	if (h.magic != UFONT_PSF2_MAGIC || h.header_size < sizeof(h)) return -1;
+	if (h.width == 0 || h.height == 0 || h.length == 0) return -1;
+	if (h.glyph_size < (uint64_t) (h.width + 7) / 8 * h.height) return -1;
+	if (h.header_size + (uint64_t) h.length * h.glyph_size > size) return -1;
+
+	ufont_raw(font, (const uint8_t *) data + h.header_size, h.length, h.width, h.height);
+	font->bytes = h.glyph_size; // 可能有填充
+	if (h.flags & UFONT_PSF2_HAS_UNICODE) {
+		font->unicode = font->glyphs + h.length * h.glyph_size;
+		font->unicode_len = size - h.header_size - h.length * h.glyph_size;
+	}
+	return 0;
+}
+
+/* 最近邻缩放，宽字符的左右两半各占一个单元 */
+void ufont_fit(const ufont_t *font, uint32_t glyph, int part, uint8_t *dst) {
+	const uint8_t *src = font->glyphs + glyph * font->bytes;
+	uint32_t box = part == UFONT_WHOLE ? UGLYPH_WIDTH : 2 * UGLYPH_WIDTH; // 缩放的目标宽度
+	uint32_t left = part == UFONT_RIGHT ? UGLYPH_WIDTH : 0;
+
+	memset(dst, 0, UGLYPH_BYTES);
+	for (uint32_t y = 0; y < UGLYPH_HEIGHT; y++) {
+		const uint8_t *row = src + (y * font->height / UGLYPH_HEIGHT) * font->row_bytes;
+		uint8_t *out = dst + y * UGLYPH_ROW_BYTES;
+
+		for (uint32_t x = 0; x < UGLYPH_WIDTH; x++) {
+			uint32_t sx = (left + x) * font->width / box;
+			if (row[sx / 8] & (0x80 >> (sx % 8))) out[x / 8] |= 0x80 >> (x % 8);
+		}
+	}
+}
+
+/*
+ * Unicode 表：每个字形一条记录，以 0xFF 结束。记录中先是 UTF-8 编码的码点，
+ * 0xFE 之后是多个码点组成的序列，不能映射到单个单元，跳过。
+ */
+void ufont_psf2_scan(const void *source, uint32_t len, uint32_t base, uint32_t *entries) {
+	const uint8_t *p = (const uint8_t *) source;
+	const uint8_t *end = p + len;
+	uint32_t glyph = 0;
+	int sequence = 0;
+
+	while (p < end) {
+		uint8_t ch = *p++;
+		uint32_t cp;
+		int need;
+
+		if (ch == 0xFF) {
+			glyph++;
+			sequence = 0;
+			continue;
+		}
+		if (ch == 0xFE) {
+			sequence = 1;
+			continue;
+		}
+
+		if (ch < 0x80) {
+			cp = ch;
+			need = 0;
+		} else if ((ch & 0xE0) == 0xC0) {
+			cp = ch & 0x1F;
+			need = 1;
+		} else if ((ch & 0xF0) == 0xE0) {
+			cp = ch & 0x0F;
+			need = 2;
+		} else if ((ch & 0xF8) == 0xF0) {
+			cp = ch & 0x07;
+			need = 3;
+		} else {
+			continue;
+		}
+		for (; need > 0 && p < end && (*p & 0xC0) == 0x80; need--) cp = (cp << 6) | (*p++ & 0x3F);
+
+		if (need || sequence) continue;
+		if (cp - base < UGLYPH_MAP_PAGE_SIZE && !entries[cp - base]) entries[cp - base] = glyph | UGLYPH_MAP_FONT;
+	}
+}
+
+void ufont_index_scan(const void *source, uint32_t len, uint32_t base, uint32_t *entries) {
+	(void) source;
+	for (uint32_t i = 0; i < UGLYPH_MAP_PAGE_SIZE && base + i < len; i++) {
+		if (!entries[i]) entries[i] = (base + i) | UGLYPH_MAP_FONT;
+	}
+}
+
+#ifdef UTERM_MMAP
+const void *ufont_map_file(const char *path, size_t *size) {
+	struct stat st;
+	void *data;
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0) return NULL;
+	if (fstat(fd, &st) < 0 || st.st_size == 0) {
+		close(fd);
+		return NULL;
+	}
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // 映射在关闭后仍然有效
+	if (data == MAP_FAILED) return NULL;
+
+	*size = st.st_size;
+	return data;
+}
+
+void ufont_unmap_file(const void *data, size_t size) {
+	munmap((void *) data, size);
+}
+#endif
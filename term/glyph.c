@@ -0,0 +1,197 @@
+#include <stdint.h>
+#include <string.h>
+#include <glyph.h>
+
+#if UGLYPH_HAVE_X86
+#include <immintrin.h>
+#endif
+
+/* 通用 C 版本，每个字节展开 8 个像素 */
+static void uglyph_expand_c(uint32_t *dst, size_t stride, const uint8_t *font, uint32_t fg, uint32_t bg) {
+	for (int i = 0; i < UGLYPH_HEIGHT; i++) {
+		uint32_t *fb_row = dst + i * stride;
+
+		for (int b = 0; b < UGLYPH_ROW_BYTES; b++, fb_row += 8) {
+			uint8_t row = font[i * UGLYPH_ROW_BYTES + b];
+			fb_row[0] = (row & 0x80) ? fg : bg;
+			fb_row[1] = (row & 0x40) ? fg : bg;
+			fb_row[2] = (row & 0x20) ? fg : bg;
+			fb_row[3] = (row & 0x10) ? fg : bg;
+			fb_row[4] = (row & 0x08) ? fg : bg;
+			fb_row[5] = (row & 0x04) ? fg : bg;
+			fb_row[6] = (row & 0x02) ? fg : bg;
+			fb_row[7] = (row & 0x01) ? fg : bg;
+		}
+	}
+}
+
+static void uglyph_expand16_c(uint16_t *dst, size_t stride, const uint8_t *font, uint16_t fg, uint16_t bg) {
+	for (int i = 0; i < UGLYPH_HEIGHT; i++) {
+		uint16_t *fb_row = dst + i * stride;
+
+		for (int b = 0; b < UGLYPH_ROW_BYTES; b++, fb_row += 8) {
+			uint8_t row = font[i * UGLYPH_ROW_BYTES + b];
+			fb_row[0] = (row & 0x80) ? fg : bg;
+			fb_row[1] = (row & 0x40) ? fg : bg;
+			fb_row[2] = (row & 0x20) ? fg : bg;
+			fb_row[3] = (row & 0x10) ? fg : bg;
+			fb_row[4] = (row & 0x08) ? fg : bg;
+			fb_row[5] = (row & 0x04) ? fg : bg;
+			fb_row[6] = (row & 0x02) ? fg : bg;
+			fb_row[7] = (row & 0x01) ? fg : bg;
+		}
+	}
+}
+
+#if UGLYPH_HAVE_X86
+/* 字形行广播后与每个像素对应的位比较，得到掩码后一次混合 */
+__attribute__((target("sse2")))
+static void uglyph_expand_sse2(uint32_t *dst, size_t stride, const uint8_t *font, uint32_t fg, uint32_t bg) {
+	const __m128i bits_lo = _mm_set_epi32(0x10, 0x20, 0x40, 0x80);
+	const __m128i bits_hi = _mm_set_epi32(0x01, 0x02, 0x04, 0x08);
+	const __m128i vfg = _mm_set1_epi32(fg);
+	const __m128i vbg = _mm_set1_epi32(bg);
+
+	for (int i = 0; i < UGLYPH_HEIGHT; i++) {
+		__m128i *fb_row = (__m128i *) (dst + i * stride);
+
+		for (int b = 0; b < UGLYPH_ROW_BYTES; b++, fb_row += 2) {
+			__m128i row = _mm_set1_epi32(font[i * UGLYPH_ROW_BYTES + b]);
+			__m128i m_lo = _mm_cmpeq_epi32(_mm_and_si128(row, bits_lo), bits_lo);
+			__m128i m_hi = _mm_cmpeq_epi32(_mm_and_si128(row, bits_hi), bits_hi);
+
+			_mm_storeu_si128(fb_row, _mm_or_si128(_mm_and_si128(m_lo, vfg), _mm_andnot_si128(m_lo, vbg)));
+			_mm_storeu_si128(fb_row + 1, _mm_or_si128(_mm_and_si128(m_hi, vfg), _mm_andnot_si128(m_hi, vbg)));
+		}
+	}
+}
+
+/* 16 位像素：字形的一个字节正好是一个 128 位寄存器 */
+__attribute__((target("sse2")))
+static void uglyph_expand16_sse2(uint16_t *dst, size_t stride, const uint8_t *font, uint16_t fg, uint16_t bg) {
+	const __m128i bits = _mm_set_epi16(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80);
+	const __m128i vfg = _mm_set1_epi16(fg);
+	const __m128i vbg = _mm_set1_epi16(bg);
+
+	for (int i = 0; i < UGLYPH_HEIGHT; i++) {
+		__m128i *fb_row = (__m128i *) (dst + i * stride);
+
+		for (int b = 0; b < UGLYPH_ROW_BYTES; b++, fb_row++) {
+			__m128i row = _mm_set1_epi16(font[i * UGLYPH_ROW_BYTES + b]);
+			__m128i mask = _mm_cmpeq_epi16(_mm_and_si128(row, bits), bits);
+			_mm_storeu_si128(fb_row, _mm_or_si128(_mm_and_si128(mask, vfg), _mm_andnot_si128(mask, vbg)));
+		}
+	}
+}
+
+__attribute__((target("avx2")))
+static void uglyph_expand_avx2(uint32_t *dst, size_t stride, const uint8_t *font, uint32_t fg, uint32_t bg) {
+	const __m256i bits = _mm256_set_epi32(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80);
+	const __m256i vfg = _mm256_set1_epi32(fg);
+	const __m256i vbg = _mm256_set1_epi32(bg);
+
+	for (int i = 0; i < UGLYPH_HEIGHT; i++) {
+		__m256i *fb_row = (__m256i *) (dst + i * stride);
+
+		for (int b = 0; b < UGLYPH_ROW_BYTES; b++, fb_row++) {
+			__m256i row = _mm256_set1_epi32(font[i * UGLYPH_ROW_BYTES + b]);
+			__m256i mask = _mm256_cmpeq_epi32(_mm256_and_si256(row, bits), bits);
+			_mm256_storeu_si256(fb_row, _mm256_blendv_epi8(vbg, vfg, mask));
+		}
+	}
+}
+#endif
+
+uglyph_expand_fn uglyph_expand_kernel = uglyph_expand_c;
+uglyph_expand16_fn uglyph_expand16_kernel = uglyph_expand16_c;
+
+/* 多个上下文可能同时初始化，内核指针用原子操作读写 */
+const char *uglyph_select_kernel() {
+	uglyph_expand_fn fn = uglyph_expand_c;
+	uglyph_expand16_fn fn16 = uglyph_expand16_c;
+	const char *name = "c";
+
+#if UGLYPH_HAVE_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		fn = uglyph_expand_avx2;
+		name = "avx2";
+	} else if (__builtin_cpu_supports("sse2")) {
+		fn = uglyph_expand_sse2;
+		name = "sse2";
+	}
+	if (__builtin_cpu_supports("sse2")) fn16 = uglyph_expand16_sse2;
+#endif
+	__atomic_store_n(&uglyph_expand_kernel, fn, __ATOMIC_RELAXED);
+	__atomic_store_n(&uglyph_expand16_kernel, fn16, __ATOMIC_RELAXED);
+	return name;
+}
+
+int uglyph_cache_init(uglyph_cache_t *cache, size_t budget, uint32_t bpp, void *(*malloc)(size_t)) {
+	size_t set_bytes = UGLYPH_CACHE_WAYS * (sizeof(uglyph_key_t) + UGLYPH_PIXELS * bpp + 1);
+	size_t nsets = 1;
+
+	memset(cache, 0, sizeof(uglyph_cache_t));
+	if (budget < set_bytes) return 0;
+
+	// 组数取不超过预算的 2 的幂
+	while (nsets * 2 * set_bytes <= budget) nsets *= 2;
+
+	cache->keys = (uglyph_key_t *) malloc(nsets * UGLYPH_CACHE_WAYS * sizeof(uglyph_key_t));
+	cache->tiles = (uint8_t *) malloc(nsets * UGLYPH_CACHE_WAYS * UGLYPH_PIXELS * bpp);
+	cache->lru = (uint8_t *) malloc(nsets);
+	memset(cache->keys, 0, nsets * UGLYPH_CACHE_WAYS * sizeof(uglyph_key_t));
+	memset(cache->lru, 0, nsets);
+	cache->set_mask = nsets - 1;
+	cache->bpp = bpp;
+
+	return 1;
+}
+
+void uglyph_cache_destroy(uglyph_cache_t *cache, void (*free)(void*)) {
+	if (cache->keys) {
+		free(cache->keys);
+		free(cache->tiles);
+		free(cache->lru);
+	}
+	memset(cache, 0, sizeof(uglyph_cache_t));
+}
+
+static inline uint32_t uglyph_hash(uint32_t ch, uint32_t fg, uint32_t bg) {
+	uint32_t h = ch * 0x9E3779B1u ^ fg * 0x85EBCA77u ^ bg * 0xC2B2AE3Du;
+	h ^= h >> 15;
+	h *= 0x2C1B3C6Du;
+	return h ^ (h >> 13);
+}
+
+const uint8_t *uglyph_cache_get(uglyph_cache_t *cache, const uint8_t *font, uint32_t ch, uint32_t fg, uint32_t bg) {
+	if (!cache->keys) return NULL;
+
+	uint32_t set = uglyph_hash(ch, fg, bg) & cache->set_mask;
+	uglyph_key_t *keys = cache->keys + set * UGLYPH_CACHE_WAYS;
+
+	for (int way = 0; way < UGLYPH_CACHE_WAYS; way++) {
+		uglyph_key_t *k = &keys[way];
+		if (k->valid && k->ch == ch && k->fg == fg && k->bg == bg) {
+			cache->hits++;
+			cache->lru[set] = !way; // 另一路成为最近最少使用
+			return cache->tiles + (set * UGLYPH_CACHE_WAYS + way) * UGLYPH_PIXELS * cache->bpp;
+		}
+	}
+
+	if (!font) return NULL; // 调用者准备好字形后再次调用
+
+	// 未命中：替换最近最少使用的一路
+	int way = cache->lru[set];
+	uint8_t *tile = cache->tiles + (set * UGLYPH_CACHE_WAYS + way) * UGLYPH_PIXELS * cache->bpp;
+
+	cache->misses++;
+	keys[way].ch = ch;
+	keys[way].fg = fg;
+	keys[way].bg = bg;
+	keys[way].valid = 1;
+	cache->lru[set] = !way;
+	uglyph_expand_bpp(tile, UGLYPH_WIDTH, font, fg, bg, cache->bpp);
+
+	return tile;
+}
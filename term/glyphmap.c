@@ -0,0 +1,134 @@
+#include <stdint.h>
+#include <string.h>
+#include <glyphmap.h>
+
+typedef struct urange
+{
+	uint32_t first;
+	uint32_t last;
+} urange_t;
+
+// 东亚宽字符（W/F）和常用的宽 emoji，按码点排序
+static const urange_t wide_ranges[] = {
+	{ 0x1100, 0x115F }, { 0x231A, 0x231B }, { 0x2329, 0x232A }, { 0x23E9, 0x23EC },
+	{ 0x23F0, 0x23F0 }, { 0x23F3, 0x23F3 }, { 0x25FD, 0x25FE }, { 0x2614, 0x2615 },
+	{ 0x2648, 0x2653 }, { 0x267F, 0x267F }, { 0x2693, 0x2693 }, { 0x26A1, 0x26A1 },
+	{ 0x26AA, 0x26AB }, { 0x26BD, 0x26BE }, { 0x26C4, 0x26C5 }, { 0x26CE, 0x26CE },
+	{ 0x26D4, 0x26D4 }, { 0x26EA, 0x26EA }, { 0x26F2, 0x26F3 }, { 0x26F5, 0x26F5 },
+	{ 0x26FA, 0x26FA }, { 0x26FD, 0x26FD }, { 0x2705, 0x2705 }, { 0x270A, 0x270B },
+	{ 0x2728, 0x2728 }, { 0x274C, 0x274C }, { 0x274E, 0x274E }, { 0x2753, 0x2755 },
+	{ 0x2757, 0x2757 }, { 0x2795, 0x2797 }, { 0x27B0, 0x27B0 }, { 0x27BF, 0x27BF },
+	{ 0x2B1B, 0x2B1C }, { 0x2B50, 0x2B50 }, { 0x2B55, 0x2B55 }, { 0x2E80, 0x303E },
+	{ 0x3041, 0x33FF }, { 0x3400, 0x4DBF }, { 0x4E00, 0x9FFF }, { 0xA000, 0xA4CF },
+	{ 0xA960, 0xA97F }, { 0xAC00, 0xD7A3 }, { 0xF900, 0xFAFF }, { 0xFE10, 0xFE19 },
+	{ 0xFE30, 0xFE6F }, { 0xFF00, 0xFF60 }, { 0xFFE0, 0xFFE6 }, { 0x16FE0, 0x16FE4 },
+	{ 0x17000, 0x18AFF }, { 0x1B000, 0x1B2FF }, { 0x1F004, 0x1F004 }, { 0x1F0CF, 0x1F0CF },
+	{ 0x1F18E, 0x1F18E }, { 0x1F191, 0x1F19A }, { 0x1F200, 0x1F251 }, { 0x1F300, 0x1F64F },
+	{ 0x1F680, 0x1F6FF }, { 0x1F900, 0x1F9FF }, { 0x1FA70, 0x1FAFF }, { 0x20000, 0x2FFFD },
+	{ 0x30000, 0x3FFFD },
+};
+
+// 组合字符和格式字符，不占单元
+static const urange_t zero_ranges[] = {
+	{ 0x0300, 0x036F }, { 0x0483, 0x0489 }, { 0x0591, 0x05BD }, { 0x0610, 0x061A },
+	{ 0x064B, 0x065F }, { 0x1AB0, 0x1AFF }, { 0x1DC0, 0x1DFF }, { 0x200B, 0x200F },
+	{ 0x202A, 0x202E }, { 0x2060, 0x2064 }, { 0x20D0, 0x20FF }, { 0xFE00, 0xFE0F },
+	{ 0xFE20, 0xFE2F }, { 0xFEFF, 0xFEFF }, { 0xE0100, 0xE01EF },
+};
+
+static int uglyph_in_ranges(const urange_t *r, uint32_t n, uint32_t cp) {
+	uint32_t lo = 0, hi = n;
+
+	if (cp < r[0].first || cp > r[n - 1].last) return 0;
+	while (lo < hi) {
+		uint32_t mid = (lo + hi) / 2;
+		if (cp > r[mid].last) lo = mid + 1;
+		else if (cp < r[mid].first) hi = mid;
+		else return 1;
+	}
+	return 0;
+}
+
+uint32_t uglyph_width(uint32_t cp) {
+	if (cp < 0x0300) return 0; // 拉丁字母等，最常见
+	if (uglyph_in_ranges(wide_ranges, sizeof(wide_ranges) / sizeof(urange_t), cp)) return UGLYPH_MAP_WIDE;
+	if (uglyph_in_ranges(zero_ranges, sizeof(zero_ranges) / sizeof(urange_t), cp)) return UGLYPH_MAP_ZERO;
+	return 0;
+}
+
+void uglyph_scan_pairs(const void *source, uint32_t len, uint32_t base, uint32_t *entries) {
+	const uglyph_pair_t *pairs = (const uglyph_pair_t *) source;
+
+	for (uint32_t i = 0; i < len; i++) {
+		uint32_t cp = pairs[i].cp;
+		if (cp >= base && cp < base + UGLYPH_MAP_PAGE_SIZE && !entries[cp - base]) {
+			entries[cp - base] = pairs[i].glyph | UGLYPH_MAP_FONT;
+		}
+	}
+}
+
+void uglyph_map_destroy(uglyph_map_t *map, void (*free)(void*)) {
+	for (int i = 0; i < UGLYPH_MAP_PAGES; i++) {
+		if (map->pages[i] && map->pages[i] != map->empty) free(map->pages[i]);
+	}
+	if (map->empty) free(map->empty);
+	memset(map->pages, 0, sizeof(map->pages));
+	map->empty = NULL;
+}
+
+/*
+ * 一页只在第一次用到时建立：扫描一遍码点表，没有字形的码点使用 fallback，
+ * 再加上宽度标志。结果与空页相同时不分配新页。
+ */
+uint32_t uglyph_map_fill(uglyph_map_t *map, uint32_t cp, void *(*malloc)(size_t)) {
+	uint32_t entries[UGLYPH_MAP_PAGE_SIZE];
+	uint32_t base = cp & ~0xFFu;
+	int plain = 1; // 全部为不带宽度的 fallback
+
+	if (cp >= UGLYPH_MAP_PAGES * UGLYPH_MAP_PAGE_SIZE) return map->fallback | uglyph_width(cp); // 表外的字符只有宽度
+
+	memset(entries, 0, sizeof(entries));
+	if (base == 0) entries[0] = map->blank | UGLYPH_MAP_FONT; // 空白单元
+	map->scan(map->source, map->source_len, base, entries);
+	for (uint32_t i = 0; i < UGLYPH_MAP_PAGE_SIZE; i++) {
+		if (!entries[i]) entries[i] = map->fallback;
+		entries[i] |= uglyph_width(base + i);
+		if (entries[i] != map->fallback) plain = 0;
+	}
+
+	uint32_t **slot = &map->pages[cp >> 8];
+	if (plain) {
+		if (!map->empty) {
+			map->empty = (uint32_t *) malloc(UGLYPH_MAP_PAGE_SIZE * sizeof(uint32_t));
+			if (!map->empty) return map->fallback;
+			memcpy(map->empty, entries, sizeof(entries));
+		}
+		*slot = map->empty;
+	} else {
+		*slot = (uint32_t *) malloc(UGLYPH_MAP_PAGE_SIZE * sizeof(uint32_t));
+		if (!*slot) return map->fallback;
+		memcpy(*slot, entries, sizeof(entries));
+	}
+	return (*slot)[cp & 0xFF];
+}
+
+int uglyph_map_init(uglyph_map_t *map, uglyph_scan_fn scan, const void *source, uint32_t len, void *(*malloc)(size_t)) {
+	uint32_t entries[UGLYPH_MAP_PAGE_SIZE];
+
+	memset(map, 0, sizeof(uglyph_map_t));
+	map->scan = scan;
+	map->source = source;
+	map->source_len = len;
+
+	// 空白为 ' ' 的字形，fallback 依次为 U+FFFD、'?'、空白
+	memset(entries, 0, sizeof(entries));
+	scan(source, len, 0, entries);
+	map->blank = entries[' '] & UGLYPH_MAP_INDEX;
+	map->fallback = entries['?'] ? entries['?'] & UGLYPH_MAP_INDEX : map->blank;
+	memset(entries, 0, sizeof(entries));
+	scan(source, len, 0xFF00, entries);
+	if (entries[0xFD]) map->fallback = entries[0xFD] & UGLYPH_MAP_INDEX;
+
+	uglyph_map_fill(map, 0, malloc);
+	return map->pages[0] ? 0 : -1;
+}
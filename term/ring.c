@@ -0,0 +1,117 @@
+#include <stdint.h>
+#include <string.h>
+#include <ring.h>
+
+static inline uint32_t uring_lap(uring_t *ring, uint32_t pos) {
+	return (pos >> ring->shift) & ring->lap_mask;
+}
+
+int uring_init(uring_t *ring, size_t size, int policy, void *(*malloc)(size_t)) {
+	uint32_t shift = 0;
+
+	memset(ring, 0, sizeof(uring_t));
+	if (size < URING_SIZE_MIN) size = URING_SIZE_MIN;
+	while (((size_t) 1 << shift) < size) shift++;
+	if (shift > 24) return -1; // 至少保留 8 位圈数
+
+	ring->slots = (uint32_t *) malloc(sizeof(uint32_t) << shift);
+	if (!ring->slots) return -1;
+
+	ring->shift = shift;
+	ring->mask = (1u << shift) - 1;
+	ring->lap_mask = 0xFFFFFFFFu >> shift;
+	if (ring->lap_mask > 0xFFFFFF) ring->lap_mask = 0xFFFFFF;
+	ring->policy = policy;
+
+	// 第 0 圈之前的一圈：全部视为未写入
+	for (uint32_t i = 0; i <= ring->mask; i++) {
+		ring->slots[i] = ring->lap_mask << 8;
+	}
+	return 0;
+}
+
+void uring_destroy(uring_t *ring, void (*free)(void*)) {
+	if (ring->slots) free(ring->slots);
+	memset(ring, 0, sizeof(uring_t));
+}
+
+/*
+ * 写入第 pos 个字节。两个相差一圈的生产者可能乱序写同一槽位，
+ * 只有槽位中的圈数更旧时才覆盖，保证消费者总能看到最新一圈。
+ */
+static void uring_store(uring_t *ring, uint32_t pos, uint8_t byte) {
+	uint32_t *slot = &ring->slots[pos & ring->mask];
+	uint32_t lap = uring_lap(ring, pos);
+	uint32_t val = (lap << 8) | byte;
+	uint32_t old = __atomic_load_n(slot, __ATOMIC_RELAXED);
+
+	do {
+		uint32_t ahead = (lap - (old >> 8)) & ring->lap_mask;
+		if (ahead == 0 || ahead > ring->lap_mask / 2) return; // 已被更新的一圈覆盖，由消费者计数
+	} while (!__atomic_compare_exchange_n(slot, &old, val, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+size_t uring_write(uring_t *ring, const char *buf, size_t len) {
+	uint32_t cap = ring->mask + 1;
+	uint32_t pos, n;
+
+	if (len == 0 || !ring->slots) return 0;
+
+	if (ring->policy == URING_DROP_OLDEST) {
+		// 一次 fetch-add 预留整段，不重试；超出容量的部分会被自己覆盖，直接跳过
+		if (len > cap) {
+			__atomic_add_fetch(&ring->dropped, (uint32_t) (len - cap), __ATOMIC_RELAXED);
+			buf += len - cap;
+			len = cap;
+		}
+		n = (uint32_t) len;
+		pos = __atomic_fetch_add(&ring->tail, n, __ATOMIC_RELAXED);
+	} else {
+		// 只预留空闲的部分。fetch-add 预留后无法撤销多出的部分，所以用 CAS，
+		// 仅在其它生产者成功时重试（无锁）
+		pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+		do {
+			uint32_t used = pos - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+			n = cap - used;
+			if (n > len) n = (uint32_t) len;
+			if (n == 0) break;
+		} while (!__atomic_compare_exchange_n(&ring->tail, &pos, pos + n, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+		if (n < len) __atomic_add_fetch(&ring->dropped, (uint32_t) (len - n), __ATOMIC_RELAXED);
+	}
+
+	for (uint32_t i = 0; i < n; i++) {
+		uring_store(ring, pos + i, (uint8_t) buf[i]);
+	}
+	return n;
+}
+
+size_t uring_read(uring_t *ring, char *buf, size_t max) {
+	uint32_t cap = ring->mask + 1;
+	uint32_t head = ring->head;
+	uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	size_t n = 0;
+
+	// 生产者已超过消费者一圈以上，最旧的数据已丢失
+	if (tail - head > cap) {
+		__atomic_add_fetch(&ring->dropped, tail - cap - head, __ATOMIC_RELAXED);
+		head = tail - cap;
+	}
+
+	while (n < max && head != tail) {
+		uint32_t val = __atomic_load_n(&ring->slots[head & ring->mask], __ATOMIC_ACQUIRE);
+		uint32_t ahead = ((val >> 8) - uring_lap(ring, head)) & ring->lap_mask;
+
+		if (ahead == 0) {
+			buf[n++] = (char) (val & 0xFF);
+		} else if (ahead > ring->lap_mask / 2) {
+			break; // 已预留但还未写入，下次再读
+		} else {
+			__atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED); // 被更新的一圈覆盖
+		}
+		head++;
+	}
+
+	__atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+	return n;
+}
@@ -0,0 +1,134 @@
+#include <stdint.h>
+#include <string.h>
+#include <scan.h>
+
+#if USCAN_HAVE_X86
+#include <immintrin.h>
+#endif
+#if USCAN_HAVE_NEON
+#include <arm_neon.h>
+#endif
+
+static inline int uscan_is_printable(uint8_t c) {
+	return c >= 0x20 && c < 0x7F;
+}
+
+/*
+ * 每次检查 8 个字节：最低的一个不可打印字节在 w、w - 0x20 或 w + 1 中
+ * 一定置最高位。可能误报（借位/进位），误报时由逐字节循环确认。
+ */
+size_t uscan_printable_c(const uint8_t *buf, size_t len) {
+	const uint64_t ones = 0x0101010101010101ull;
+	const uint64_t high = 0x8080808080808080ull;
+	size_t i = 0;
+
+	for (; i + 8 <= len; i += 8) {
+		uint64_t w;
+		memcpy(&w, buf + i, 8);
+		uint64_t bad = w | (w - 0x20 * ones) | (w + ones);
+		if (bad & high) break;
+	}
+	while (i < len && uscan_is_printable(buf[i])) i++;
+	return i;
+}
+
+#if USCAN_HAVE_X86
+/* 有符号比较：0x80 以上为负数，与 0x1F < b < 0x7F 一起判断 */
+__attribute__((target("sse2")))
+static size_t uscan_printable_sse2(const uint8_t *buf, size_t len) {
+	const __m128i lo = _mm_set1_epi8(0x1F);
+	const __m128i hi = _mm_set1_epi8(0x7F);
+	size_t i = 0;
+
+	for (; i + 16 <= len; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (buf + i));
+		__m128i ok = _mm_and_si128(_mm_cmpgt_epi8(v, lo), _mm_cmplt_epi8(v, hi));
+		uint32_t mask = _mm_movemask_epi8(ok) ^ 0xFFFF;
+		if (mask) return i + __builtin_ctz(mask);
+	}
+	return i + uscan_printable_c(buf + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static size_t uscan_printable_avx2(const uint8_t *buf, size_t len) {
+	const __m256i lo = _mm256_set1_epi8(0x1F);
+	const __m256i hi = _mm256_set1_epi8(0x7F);
+	size_t i = 0;
+
+	for (; i + 32 <= len; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) (buf + i));
+		__m256i ok = _mm256_and_si256(_mm256_cmpgt_epi8(v, lo), _mm256_cmpgt_epi8(hi, v));
+		uint32_t mask = ~(uint32_t) _mm256_movemask_epi8(ok);
+		if (mask) return i + __builtin_ctz(mask);
+	}
+	return i + uscan_printable_c(buf + i, len - i);
+}
+#endif
+
+#if USCAN_HAVE_NEON
+static size_t uscan_printable_neon(const uint8_t *buf, size_t len) {
+	const uint8x16_t lo = vdupq_n_u8(0x20);
+	const uint8x16_t hi = vdupq_n_u8(0x7F);
+	size_t i = 0;
+
+	for (; i + 16 <= len; i += 16) {
+		uint8x16_t v = vld1q_u8(buf + i);
+		uint8x16_t ok = vandq_u8(vcgeq_u8(v, lo), vcltq_u8(v, hi));
+		if (vminvq_u8(ok) != 0xFF) break; // 本块中有不可打印字节
+	}
+	return i + uscan_printable_c(buf + i, len - i);
+}
+#endif
+
+#if USCAN_HAVE_NEON
+uscan_fn uscan_kernel = uscan_printable_neon;
+#else
+uscan_fn uscan_kernel = uscan_printable_c;
+#endif
+
+uscan_fn uscan_kernel_at(int i, const char **name) {
+	switch (i) {
+		case 0:
+			*name = "c";
+			return uscan_printable_c;
+#if USCAN_HAVE_X86
+		case 1:
+			*name = "sse2";
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("sse2") ? uscan_printable_sse2 : NULL;
+		case 2:
+			*name = "avx2";
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2") ? uscan_printable_avx2 : NULL;
+#elif USCAN_HAVE_NEON
+		case 1:
+			*name = "neon";
+			return uscan_printable_neon;
+#endif
+		default:
+			*name = NULL;
+			return NULL;
+	}
+}
+
+const char *uscan_select_kernel() {
+#if USCAN_HAVE_X86
+	uscan_fn fn = uscan_printable_c;
+	const char *name = "c";
+
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		fn = uscan_printable_avx2;
+		name = "avx2";
+	} else if (__builtin_cpu_supports("sse2")) {
+		fn = uscan_printable_sse2;
+		name = "sse2";
+	}
+	__atomic_store_n(&uscan_kernel, fn, __ATOMIC_RELAXED);
+	return name;
+#elif USCAN_HAVE_NEON
+	return "neon";
+#else
+	return "c";
+#endif
+}
@@ -0,0 +1,144 @@
+#include <stdint.h>
+#include <string.h>
+#include <scrollback.h>
+
+int uscrollback_init(uscrollback_t *sb, size_t budget, uint32_t cols, void *(*malloc)(size_t)) {
+	memset(sb, 0, sizeof(uscrollback_t));
+	sb->cols = cols;
+	if (budget == 0) return 0;
+
+	// 每行至少 USCROLLBACK_MIN_LINE 字节加一个索引项
+	size_t max_lines = budget / (USCROLLBACK_MIN_LINE + sizeof(uint32_t));
+	size_t arena_size = (budget - max_lines * sizeof(uint32_t)) & ~(size_t) 3;
+	if (max_lines == 0 || arena_size > 0xFFFFFFFF) return -1;
+
+	sb->lines = (uint32_t *) malloc(max_lines * sizeof(uint32_t));
+	sb->arena = (uint8_t *) malloc(arena_size);
+	if (!sb->lines || !sb->arena) return -1;
+
+	sb->max_lines = (uint32_t) max_lines;
+	sb->arena_size = (uint32_t) arena_size;
+	return 0;
+}
+
+void uscrollback_destroy(uscrollback_t *sb, void (*free)(void*)) {
+	if (sb->lines) free(sb->lines);
+	if (sb->arena) free(sb->arena);
+	memset(sb, 0, sizeof(uscrollback_t));
+}
+
+void uscrollback_clear(uscrollback_t *sb) {
+	sb->first = 0;
+	sb->count = 0;
+	sb->tail = 0;
+}
+
+static inline int uscrollback_same_attr(const ucell_t *a, const ucell_t *b) {
+	return a->fg == b->fg && a->bg == b->bg && a->attr == b->attr;
+}
+
+/* 淘汰最旧的一行 */
+static inline void uscrollback_evict(uscrollback_t *sb) {
+	sb->first = (sb->first + 1 == sb->max_lines) ? 0 : sb->first + 1;
+	sb->count--;
+}
+
+/* 淘汰最旧的行，直到 arena 的 [pos, end) 中没有记录 */
+static void uscrollback_reclaim(uscrollback_t *sb, uint32_t pos, uint32_t end) {
+	while (sb->count > 0) {
+		uint32_t head = sb->lines[sb->first];
+		if (head < pos || head >= end) break;
+		uscrollback_evict(sb);
+	}
+}
+
+void uscrollback_push(uscrollback_t *sb, const ucell_t *cells) {
+	uint32_t chars = sb->cols;
+	uint32_t spans = 0;
+	int wide = 0;
+
+	if (!sb->arena || sb->cols == 0) return;
+
+	// 行尾与最后一个单元相同的空白单元不保存字符
+	const ucell_t *last = &cells[sb->cols - 1];
+	if (last->ch == 0 || last->ch == ' ') {
+		while (chars > 0 && cells[chars - 1].ch == last->ch && uscrollback_same_attr(&cells[chars - 1], last)) chars--;
+	}
+
+	for (uint32_t x = 0; x < sb->cols; x++) {
+		if (x == 0 || !uscrollback_same_attr(&cells[x], &cells[x - 1])) spans++;
+		if (x < chars && cells[x].ch > 0xFF) wide = 1;
+	}
+
+	uint32_t need = sizeof(uscrollback_line_t) + spans * sizeof(uscrollback_span_t) + chars * (wide ? 4 : 1);
+	need = (need + 3) & ~3u;
+	if (need > sb->arena_size) return;
+
+	if (sb->count == sb->max_lines) uscrollback_evict(sb);
+
+	uint32_t pos = sb->tail;
+	if (pos + need > sb->arena_size) { // 尾部放不下，回到开头
+		uscrollback_reclaim(sb, pos, sb->arena_size);
+		pos = 0;
+	}
+	uscrollback_reclaim(sb, pos, pos + need);
+
+	uscrollback_line_t *line = (uscrollback_line_t *) (sb->arena + pos);
+	uscrollback_span_t *span = (uscrollback_span_t *) (line + 1);
+	line->chars = chars;
+	line->spans = spans;
+	line->wide = wide;
+	line->fill = (uint8_t) last->ch;
+
+	span--;
+	for (uint32_t x = 0; x < sb->cols; x++) {
+		if (x == 0 || !uscrollback_same_attr(&cells[x], &cells[x - 1])) {
+			span++;
+			span->count = 0;
+			span->attr = cells[x].attr;
+			span->fg = cells[x].fg;
+			span->bg = cells[x].bg;
+		}
+		span->count++;
+	}
+
+	if (wide) {
+		uint32_t *ch = (uint32_t *) (span + 1);
+		for (uint32_t x = 0; x < chars; x++) ch[x] = cells[x].ch;
+	} else {
+		uint8_t *ch = (uint8_t *) (span + 1);
+		for (uint32_t x = 0; x < chars; x++) ch[x] = (uint8_t) cells[x].ch;
+	}
+
+	uint32_t slot = sb->first + sb->count;
+	if (slot >= sb->max_lines) slot -= sb->max_lines;
+	sb->lines[slot] = pos;
+	sb->count++;
+	sb->tail = pos + need;
+}
+
+int uscrollback_get(const uscrollback_t *sb, uint32_t index, ucell_t *cells) {
+	if (index >= sb->count) return -1;
+
+	uint32_t slot = sb->first + index;
+	if (slot >= sb->max_lines) slot -= sb->max_lines;
+
+	const uscrollback_line_t *line = (const uscrollback_line_t *) (sb->arena + sb->lines[slot]);
+	const uscrollback_span_t *span = (const uscrollback_span_t *) (line + 1);
+	const void *chars = span + line->spans;
+	uint32_t x = 0;
+
+	for (uint32_t s = 0; s < line->spans; s++, span++) {
+		for (uint32_t i = 0; i < span->count && x < sb->cols; i++, x++) {
+			if (x < line->chars) {
+				cells[x].ch = line->wide ? ((const uint32_t *) chars)[x] : ((const uint8_t *) chars)[x];
+			} else {
+				cells[x].ch = line->fill;
+			}
+			cells[x].fg = span->fg;
+			cells[x].bg = span->bg;
+			cells[x].attr = span->attr;
+		}
+	}
+	return 0;
+}
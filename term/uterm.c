@@ -1,71 +1,167 @@
 #include <stdint.h>
 #include <uterm.h>
 #include <buffer.h>
+#include <glyph.h>
+#include <context.h>
+#include <pixel.h>
+#include <fill.h>
+#include <scan.h>
 #include <string.h>
 #include <stdio.h>
 
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 #define MAX(a, b) ((a) < (b) ? (b) : (a))
 
-static uint32_t *uframebuffer;
-
-static ssize_t term_width = 0;		// Terminal width
-static ssize_t term_height = 0;		// Terminal height
-static uint32_t cell_count = 0;		// The count of all the cells.
-static uint32_t cell_cols = 0;		// The count of the cells of col.
-static uint32_t cell_lines = 0;		// The count of the cells of line.
-
-static ubuffer_t *front_buffer;
-static ubuffer_t *back_buffer;
-
-static vt100_t *vtcontrol;
-
 extern uint8_t ascfont[];
+extern const uint32_t ascfont_count;
+extern const uglyph_pair_t ascfont_unicode[];
+extern const uint32_t ascfont_unicode_count;
+
+static void swap_buffers(uterm_t *ut);
+static int uterm_cursor_prepare(uterm_t *ut);
+static void uterm_overlay_cursor(uterm_t *ut);
+static void uterm_render_glyph(uterm_t *ut, uglyph_cache_t *cache, uint8_t *fb, uint32_t glyph, int part, int cellx, int celly, uint32_t rgbaF, uint32_t rgbaB);
+static void uterm_render_cell(uterm_t *ut, uglyph_cache_t *cache, uint8_t *fb, const ucell_t *c, int cellx, int celly, int invert);
+static void uterm_rasterize(uterm_t *ut);
+static void uterm_init_caches(uterm_t *ut);
+static void uterm_destroy_caches(uterm_t *ut);
+static void uterm_check_blank(uterm_t *ut);
+static void handle_csi_dispatch(uterm_t *ut, uint8_t final);
+static void handle_esc_dispatch(uterm_t *ut, uint8_t final);
+static void handle_backspace(uterm_t *ut);
+static void handle_ansi_sgr(uterm_t *ut);
+static void uterm_reset_attr(uterm_t *ut);
+
+static const uint32_t base_colors[16] = { // 包含普通和亮色（RGBA）
+	0x000000FF, 0xFF0000FF, 0x00FF00FF, 0xFFFF00FF,
+	0x0000FFFF, 0xFF00FFFF, 0x00FFFFFF, 0xFFFFFFFF, // 普通色
+	0x808080FF, 0xFF8080FF, 0x80FF80FF, 0xFFFF80FF,
+	0x8080FFFF, 0xFF80FFFF, 0x80FFFFFF, 0xFFFFFFFF  // 亮色
+};
+
+/*
+ * 调色板只在设置像素格式时换算一次：16 个基本色，6x6x6 颜色立方体，
+ * 24 级灰度（与 xterm 相同）。24 位颜色的缓存同时清空。
+ */
+static void uterm_build_palette(uterm_t *ut) {
+	static const uint8_t levels[6] = { 0x00, 0x5F, 0x87, 0xAF, 0xD7, 0xFF };
 
-static int cursor_visible = 0;
-static uint32_t saved_cursor_cellx, saved_cursor_celly;
+	for (int i = 0; i < 16; i++) {
+		ut->palette[i] = upixel_from_rgba(ut->format, base_colors[i]);
+	}
+	for (int i = 0; i < 216; i++) {
+		uint32_t rgba = (uint32_t) levels[i / 36] << 24 | (uint32_t) levels[i / 6 % 6] << 16 | (uint32_t) levels[i % 6] << 8 | 0xFF;
+		ut->palette[16 + i] = upixel_from_rgba(ut->format, rgba);
+	}
+	for (int i = 0; i < 24; i++) {
+		uint32_t v = 8 + 10 * i;
+		ut->palette[232 + i] = upixel_from_rgba(ut->format, v << 24 | v << 16 | v << 8 | 0xFF);
+	}
+	memset(ut->truecolor_key, 0, sizeof(ut->truecolor_key));
+}
 
-void *(*umalloc)(size_t target);	// uterm malloc
-void (*ufree)(void *target);		// uterm free
+/* 24 位颜色：同一个颜色通常在每个词法记号上重复出现，换算结果按 RGB 缓存 */
+static uint32_t uterm_truecolor(uterm_t *ut, uint32_t r, uint32_t g, uint32_t b) {
+	uint32_t rgb = r << 16 | g << 8 | b;
+	uint32_t slot = (rgb * 0x9E3779B1u) >> 16 & (UTERM_TRUECOLOR_CACHE - 1);
 
-uint32_t cursorx, cursory = 0;
+	if (ut->truecolor_key[slot] != (rgb | UTERM_TRUECOLOR_VALID)) {
+		ut->truecolor_key[slot] = rgb | UTERM_TRUECOLOR_VALID;
+		ut->truecolor_pixel[slot] = upixel_from_rgba(ut->format, rgb << 8 | 0xFF);
+	}
+	return ut->truecolor_pixel[slot];
+}
 
-static void swap_buffers(void);
-static void uterm_putcursor(void);
-static void handle_vt100_command(void);
-static void handle_backspace(void);
-static uint32_t ansi_to_rgba(int index, int bright);
-static void handle_ansi_sgr(void);
+static inline uint32_t ansi_color(uterm_t *ut, int index, int bright) {
+	return ut->palette[index + (bright ? 8 : 0)];
+}
 
-static uint32_t ansi_to_rgba(int index, int bright) {
-	static const uint32_t base_colors[16] = { // 包含普通和亮色
-		0x000000FF, 0xFF0000FF, 0x00FF00FF, 0xFFFF00FF,
-		0x0000FFFF, 0xFF00FFFF, 0x00FFFFFF, 0xFFFFFFFF, // 普通色
-		0x808080FF, 0xFF8080FF, 0x80FF80FF, 0xFFFF80FF,
-		0x8080FFFF, 0xFF80FFFF, 0x80FFFFFF, 0xFFFFFFFF  // 亮色
-	};
-	return base_colors[index + (bright ? 8 : 0)];
+/*
+ * 38/48/58 之后的扩展颜色，params[i] 为 38/48/58。支持 ';' 分隔的 5;n、2;r;g;b
+ * 和 ':' 分隔的 5:n、2:r:g:b、2:id:r:g:b。颜色有效时写入 *color，
+ * 返回用掉的参数个数（不含 params[i]）。
+ */
+static int uterm_sgr_color(uterm_t *ut, int i, int count, uint32_t *color) {
+	vt100_t *vt = &ut->vtcontrol;
+	const int *p = &vt->params[i + 1];
+	int sub = i + 1 < count && (vt->param_sub & (1u << (i + 1)));
+	int n = 0; // 可用的参数
+
+	if (sub) {
+		while (i + 1 + n < count && (vt->param_sub & (1u << (i + 1 + n)))) n++;
+	} else {
+		n = count - i - 1;
+	}
+	if (n < 1) return 0;
+
+	switch (p[0]) {
+		case 5:
+			if (n >= 2 && p[1] < 256) *color = ut->palette[p[1]];
+			return sub ? n : MIN(n, 2);
+		case 2:
+			if (sub && n >= 5) p++; // 跳过色彩空间
+			if (n >= 4 && p[1] < 256 && p[2] < 256 && p[3] < 256) *color = uterm_truecolor(ut, p[1], p[2], p[3]);
+			return sub ? n : MIN(n, 4);
+		default:
+			return sub ? n : 1;
+	}
 }
 
-static void handle_ansi_sgr() {
-	for (int i = 0; i <= vtcontrol->param_count; i++) {
-		int code = vtcontrol->params[i];
+static void handle_ansi_sgr(uterm_t *ut) {
+	int count = ut->vtcontrol.param_count ? ut->vtcontrol.param_count : 1; // 无参数等于 0
+	uint32_t ignored;
+
+	for (int i = 0; i < count; i++) {
+		int code = ut->vtcontrol.params[i];
+		if (ut->vtcontrol.param_sub & (1u << i)) continue; // 未支持的子参数
 		switch (code) {
 			case 0: // Reset
-				vtcontrol->current_fg = ansi_to_rgba(ANSI_COLOR_WHITE, 0);
-				vtcontrol->current_bg = ansi_to_rgba(ANSI_COLOR_BLACK, 0);
+				uterm_reset_attr(ut);
+				break;
+			case 1:
+				ut->vtcontrol.bold = 1;
+				break;
+			case 4:
+				ut->vtcontrol.underline = 1;
+				break;
+			case 7:
+				ut->vtcontrol.reverse = 1;
+				break;
+			case 22:
+				ut->vtcontrol.bold = 0;
+				break;
+			case 24:
+				ut->vtcontrol.underline = 0;
+				break;
+			case 27:
+				ut->vtcontrol.reverse = 0;
+				break;
+			case 39:
+				ut->vtcontrol.current_fg = ansi_color(ut, ANSI_COLOR_WHITE, 0);
+				break;
+			case 49:
+				ut->vtcontrol.current_bg = ansi_color(ut, ANSI_COLOR_BLACK, 0);
 				break;
 			case 30 ... 37:
-				vtcontrol->current_fg = ansi_to_rgba(code - 30, 0);
+				ut->vtcontrol.current_fg = ansi_color(ut, code - 30, 0);
 				break;
 			case 40 ... 47:
-				vtcontrol->current_bg = ansi_to_rgba(code - 40, 0);
+				ut->vtcontrol.current_bg = ansi_color(ut, code - 40, 0);
 				break;
 			case 90 ... 97:
-				vtcontrol->current_fg = ansi_to_rgba(code - 90, 1);
+				ut->vtcontrol.current_fg = ansi_color(ut, code - 90, 1);
 				break;
 			case 100 ... 107:
-				vtcontrol->current_bg = ansi_to_rgba(code - 100, 1);
+				ut->vtcontrol.current_bg = ansi_color(ut, code - 100, 1);
+				break;
+			case 38:
+				i += uterm_sgr_color(ut, i, count, &ut->vtcontrol.current_fg);
+				break;
+			case 48:
+				i += uterm_sgr_color(ut, i, count, &ut->vtcontrol.current_bg);
+				break;
+			case 58: // 下划线颜色，只跳过参数
+				i += uterm_sgr_color(ut, i, count, &ignored);
 				break;
 			default:
 				break;
@@ -73,381 +169,1506 @@ static void handle_ansi_sgr() {
 	}
 }
 
-static void handle_vt100_command() {
-	// 直接访问 params[0] 和 params[1]，避免循环
-	int p1 = vtcontrol->params[0];
-	int p2 = vtcontrol->params[1];
+static uint32_t uterm_current_attr(uterm_t *ut) {
+	return (ut->vtcontrol.bold ? UCELL_ATTR_BOLD : 0) |
+		(ut->vtcontrol.underline ? UCELL_ATTR_UNDERLINE : 0) |
+		(ut->vtcontrol.reverse ? UCELL_ATTR_REVERSE : 0);
+}
+
+/* 用当前背景色清空一个单元 */
+static inline void uterm_blank_cell(uterm_t *ut, ucell_t *c) {
+	c->ch = 0;
+	c->fg = ut->vtcontrol.current_fg;
+	c->bg = ut->vtcontrol.current_bg;
+	c->attr = 0;
+}
+
+/* 置位位图第 celly 行的 [x0, x1) */
+static void uterm_bitmap_set(uterm_t *ut, uint32_t *map, int x0, int x1, int celly) {
+	uint32_t *row = map + celly * ut->bitmap_stride;
+
+	while (x0 < x1) {
+		int bit = x0 & 31;
+		int n = MIN(32 - bit, x1 - x0);
+		row[x0 >> 5] |= (n == 32) ? 0xFFFFFFFF : (((1u << n) - 1) << bit);
+		x0 += n;
+	}
+}
+
+/* 从 from 开始查找位图行中下一个值为 set 的位，找不到返回 ut->cell_cols */
+static uint32_t uterm_bitmap_find(uterm_t *ut, const uint32_t *row, uint32_t from, int set) {
+	while (from < ut->cell_cols) {
+		uint32_t w = set ? row[from >> 5] : ~row[from >> 5];
+		w &= 0xFFFFFFFF << (from & 31);
+		if (w) return MIN(ut->cell_cols, (from & ~31u) + __builtin_ctz(w));
+		from = (from & ~31u) + 32;
+	}
+	return ut->cell_cols;
+}
+
+/*
+ * 后缓冲的像素、单元和修改位图按物理行环形存放，屏幕第 celly 行
+ * 对应物理行 (ut->row_origin + celly) % ut->cell_lines。滚屏只移动 ut->row_origin，
+ * 在 flush 复制到前缓冲时才展开。损坏位图按屏幕行存放。
+ */
+static inline uint32_t uterm_phys_row(uterm_t *ut, uint32_t celly) {
+	uint32_t row = celly + ut->row_origin;
+	return row >= ut->cell_lines ? row - ut->cell_lines : row;
+}
+
+/* 屏幕第 celly 行的单元 */
+static inline ucell_t *uterm_line(uterm_t *ut, ucell_t *cells, uint32_t celly) {
+	return cells + uterm_phys_row(ut, celly) * ut->cell_cols;
+}
+
+/* 标记屏幕第 celly 行 [x0, x1) 的单元为已修改，在 flush 时光栅化 */
+static inline void uterm_mark_changed(uterm_t *ut, int x0, int x1, int celly) {
+	uterm_bitmap_set(ut, ut->back_buffer.changed, x0, x1, uterm_phys_row(ut, celly));
+}
+
+/* 标记第 celly 行 [x0, x1) 的单元为损坏，在 flush 时复制到前缓冲 */
+static inline void uterm_mark_damage(uterm_t *ut, int x0, int x1, int celly) {
+	uterm_bitmap_set(ut, ut->back_buffer.damage, x0, x1, celly);
+}
+
+static inline int uterm_is_damaged(uterm_t *ut, int cellx, int celly) {
+	return (ut->back_buffer.damage[celly * ut->bitmap_stride + (cellx >> 5)] >> (cellx & 31)) & 1;
+}
+
+/* 第 i 个参数，缺省或为 0 时返回 def */
+static inline int uterm_param(uterm_t *ut, int i, int def) {
+	return (i < ut->vtcontrol.param_count && ut->vtcontrol.params[i] > 0) ? ut->vtcontrol.params[i] : def;
+}
+
+/* 用当前背景色清空屏幕第 celly 行（line）的 [x0, x1)，像素在 flush 时按段填充 */
+static void uterm_clear_cells(uterm_t *ut, ucell_t *line, uint32_t x0, uint32_t x1, uint32_t celly) {
+	ucell_t blank;
+
+	uterm_blank_cell(ut, &blank);
+	for (uint32_t x = x0; x < x1; x++) {
+		line[x] = blank;
+	}
+	uterm_mark_changed(ut, x0, x1, celly);
+}
+
+/* 即将覆盖屏幕第 celly 行的 [x0, x1)：被拆开的宽字符剩下的一半清空 */
+static inline void uterm_split_wide(uterm_t *ut, ucell_t *line, uint32_t x0, uint32_t x1, uint32_t celly) {
+	if (x0 > 0 && x0 < ut->cell_cols && (line[x0].attr & UCELL_ATTR_WIDE_TAIL)) uterm_clear_cells(ut, line, x0 - 1, x0, celly);
+	if (x1 < ut->cell_cols && (line[x1].attr & UCELL_ATTR_WIDE_TAIL)) uterm_clear_cells(ut, line, x1, x1 + 1, celly);
+}
+
+/* 清空屏幕第 celly 行的 [x0, x1)，两端拆开的宽字符整个清空 */
+static void uterm_blank_range(uterm_t *ut, uint32_t celly, uint32_t x0, uint32_t x1) {
+	ucell_t *line = uterm_line(ut, ut->back_buffer.cell, celly);
+
+	if (x1 > ut->cell_cols) x1 = ut->cell_cols;
+	if (x0 >= x1) return;
+	uterm_split_wide(ut, line, x0, x1, celly);
+	uterm_clear_cells(ut, line, x0, x1, celly);
+}
+
+/*
+ * 把屏幕第 src 行整行移到第 dst 行：后缓冲的像素、已绘制的单元（front_buffer.cell）
+ * 和修改位图一起复制，已光栅化的单元不需要重画，只需要复制到前缓冲。
+ */
+static void uterm_copy_row(uterm_t *ut, uint32_t dst, uint32_t src) {
+	uint32_t pd = uterm_phys_row(ut, dst);
+	uint32_t ps = uterm_phys_row(ut, src);
+	size_t cells = ut->cell_cols * sizeof(ucell_t);
+
+	memcpy(ut->back_buffer.cell + pd * ut->cell_cols, ut->back_buffer.cell + ps * ut->cell_cols, cells);
+	memcpy(ut->front_buffer.cell + pd * ut->cell_cols, ut->front_buffer.cell + ps * ut->cell_cols, cells);
+	memcpy(ut->back_buffer.fb + pd * UGLYPH_HEIGHT * ut->pitch, ut->back_buffer.fb + ps * UGLYPH_HEIGHT * ut->pitch, UGLYPH_HEIGHT * ut->pitch);
+	memcpy(ut->back_buffer.changed + pd * ut->bitmap_stride, ut->back_buffer.changed + ps * ut->bitmap_stride, ut->bitmap_stride * sizeof(uint32_t));
+	uterm_mark_damage(ut, 0, ut->cell_cols, dst);
+	USTAT_ADD(ut, moved_pixels, (uint64_t) ut->cell_cols * UGLYPH_PIXELS);
+}
+
+/* 屏幕行 [top, bottom) 中，把从 from 开始的行移到 to，剩余的行清空 */
+static void uterm_move_lines(uterm_t *ut, uint32_t from, uint32_t to, uint32_t bottom) {
+	uint32_t n = bottom - MAX(from, to);
+
+	if (to < from) { // 向上移动
+		for (uint32_t i = 0; i < n; i++) uterm_copy_row(ut, to + i, from + i);
+		for (uint32_t y = to + n; y < bottom; y++) uterm_blank_range(ut, y, 0, ut->cell_cols);
+	} else { // 向下移动
+		for (uint32_t i = n; i-- > 0;) uterm_copy_row(ut, to + i, from + i);
+		for (uint32_t y = from; y < to; y++) uterm_blank_range(ut, y, 0, ut->cell_cols);
+	}
+}
+
+static inline void uterm_bit_put(uint32_t *row, uint32_t i, uint32_t bit) {
+	row[i >> 5] = (row[i >> 5] & ~(1u << (i & 31))) | (bit << (i & 31));
+}
+
+/* 屏幕第 celly 行中，把 [src, src + n) 的单元连同像素和修改位一起移到 dst */
+static void uterm_move_cells(uterm_t *ut, uint32_t celly, uint32_t dst, uint32_t src, uint32_t n) {
+	uint32_t y = uterm_phys_row(ut, celly);
+	ucell_t *back = ut->back_buffer.cell + y * ut->cell_cols;
+	ucell_t *front = ut->front_buffer.cell + y * ut->cell_cols;
+	uint32_t *changed = ut->back_buffer.changed + y * ut->bitmap_stride;
+	uint8_t *fb = ut->back_buffer.fb + y * UGLYPH_HEIGHT * ut->pitch;
+	size_t cell_bytes = UGLYPH_WIDTH * ut->bpp;
+
+	if (n == 0 || dst == src) return;
+	memmove(back + dst, back + src, n * sizeof(ucell_t));
+	memmove(front + dst, front + src, n * sizeof(ucell_t));
+	for (int i = 0; i < UGLYPH_HEIGHT; i++) {
+		memmove(fb + i * ut->pitch + dst * cell_bytes, fb + i * ut->pitch + src * cell_bytes, n * cell_bytes);
+	}
+	if (dst < src) {
+		for (uint32_t i = 0; i < n; i++) uterm_bit_put(changed, dst + i, (changed[(src + i) >> 5] >> ((src + i) & 31)) & 1);
+	} else {
+		for (uint32_t i = n; i-- > 0;) uterm_bit_put(changed, dst + i, (changed[(src + i) >> 5] >> ((src + i) & 31)) & 1);
+	}
+	uterm_mark_damage(ut, MIN(dst, src), MAX(dst, src) + n, celly);
+	USTAT_ADD(ut, moved_pixels, (uint64_t) n * UGLYPH_PIXELS);
+}
+
+/* 滚动区域向上滚动 n 行。整个屏幕滚动时只移动环形的起点，滚出的行保存到回滚缓冲 */
+static void uterm_scroll_up(uterm_t *ut, uint32_t n) {
+	uint32_t top = ut->scroll_top;
+	uint32_t bottom = ut->scroll_bottom;
+
+	n = MIN(n, bottom - top);
+	if (top == 0 && bottom == ut->cell_lines) {
+		for (uint32_t i = 0; i < n; i++) uterm_ctx_scroll(ut);
+	} else {
+		uterm_move_lines(ut, top + n, top, bottom);
+	}
+}
+
+static void uterm_scroll_down(uterm_t *ut, uint32_t n) {
+	uint32_t top = ut->scroll_top;
+	uint32_t bottom = ut->scroll_bottom;
+
+	uterm_move_lines(ut, top, top + MIN(n, bottom - top), bottom);
+}
+
+/* 光标下移一行，到滚动区域底部时滚动 */
+static void uterm_index(uterm_t *ut) {
+	if (ut->cursory + 1 == ut->scroll_bottom) {
+		uterm_scroll_up(ut, 1);
+	} else if (ut->cursory + 1 < ut->cell_lines) {
+		ut->cursory++;
+	}
+}
+
+/* 光标上移一行，到滚动区域顶部时向下滚动 */
+static void uterm_reverse_index(uterm_t *ut) {
+	if (ut->cursory == ut->scroll_top) {
+		uterm_scroll_down(ut, 1);
+	} else if (ut->cursory > 0) {
+		ut->cursory--;
+	}
+}
+
+static inline int uterm_in_region(uterm_t *ut, uint32_t celly) {
+	return celly >= ut->scroll_top && celly < ut->scroll_bottom;
+}
+
+static void uterm_save_cursor(uterm_t *ut) {
+	vt100_t *vt = &ut->vtcontrol;
 
-	switch (vtcontrol->command) {
+	vt->saved_x = ut->cursorx;
+	vt->saved_y = ut->cursory;
+	vt->saved_fg = vt->current_fg;
+	vt->saved_bg = vt->current_bg;
+	vt->saved_bold = vt->bold;
+	vt->saved_underline = vt->underline;
+	vt->saved_reverse = vt->reverse;
+}
+
+static void uterm_restore_cursor(uterm_t *ut) {
+	vt100_t *vt = &ut->vtcontrol;
+
+	ut->cursorx = MIN(vt->saved_x, ut->cell_cols - 1);
+	ut->cursory = MIN(vt->saved_y, ut->cell_lines - 1);
+	vt->current_fg = vt->saved_fg;
+	vt->current_bg = vt->saved_bg;
+	vt->bold = vt->saved_bold;
+	vt->underline = vt->saved_underline;
+	vt->reverse = vt->saved_reverse;
+}
+
+/* 恢复默认属性 */
+static void uterm_reset_attr(uterm_t *ut) {
+	ut->vtcontrol.current_fg = ansi_color(ut, ANSI_COLOR_WHITE, 0);
+	ut->vtcontrol.current_bg = ansi_color(ut, ANSI_COLOR_BLACK, 0);
+	ut->vtcontrol.bold = ut->vtcontrol.underline = ut->vtcontrol.reverse = 0;
+}
+
+static void handle_csi_dispatch(uterm_t *ut, uint8_t final) {
+	int x = ut->cursorx;
+	int y = ut->cursory;
+	int cols = ut->cell_cols;
+	int lines = ut->cell_lines;
+	int n = uterm_param(ut, 0, 1); // 大多数命令的次数参数
+
+	if (ut->vtcontrol.intermediate_count > 0) return; // 未支持带中间字节的命令
+
+	if (ut->vtcontrol.private_marker) {
+		if (ut->vtcontrol.private_marker == '?' && (final == 'h' || final == 'l')) {
+			for (int i = 0; i < ut->vtcontrol.param_count; i++) {
+				if (ut->vtcontrol.params[i] == 25) ut->cursor_visible = (final == 'h'); // DECTCEM
+			}
+		}
+		return;
+	}
+
+	switch (final) {
 		// 光标移动
-		case 'G': // 水平绝对定位
-			cursorx = (p1 > 0) ? MIN(cell_cols-1, p1-1) : 0;
+		case 'A': // CUU 上移
+			ut->cursory = MAX(0, y - n);
 			break;
-		case 'A': // 上移
-			cursory = (p1 > 0) ? MAX(0, cursory - p1) : MAX(0, cursory - 1);
+		case 'B': // CUD 下移
+		case 'e': // VPR
+			ut->cursory = MIN(lines - 1, y + n);
 			break;
-
-		case 'B': // 下移
-			cursory = (p1 > 0) ? MIN(cell_lines - 1, cursory + p1) : MIN(cell_lines - 1, cursory + 1);
+		case 'C': // CUF 右移
+		case 'a': // HPR
+			ut->cursorx = MIN(cols - 1, x + n);
 			break;
-
-		case 'C': // 右移
-			cursorx = (p1 > 0) ? MIN(cell_cols - 1, cursorx + p1) : MIN(cell_cols - 1, cursorx + 1);
+		case 'D': // CUB 左移
+			ut->cursorx = MAX(0, x - n);
 			break;
-
-		case 'D': // 左移
-			cursorx = (p1 > 0) ? MAX(0, cursorx - p1) : MAX(0, cursorx - 1);
+		case 'E': // CNL 下移到行首
+			ut->cursory = MIN(lines - 1, y + n);
+			ut->cursorx = 0;
+			break;
+		case 'F': // CPL 上移到行首
+			ut->cursory = MAX(0, y - n);
+			ut->cursorx = 0;
+			break;
+		case 'G': // CHA 水平绝对定位
+		case '`': // HPA
+			ut->cursorx = MIN(cols, n) - 1;
+			break;
+		case 'd': // VPA 垂直绝对定位
+			ut->cursory = MIN(lines, n) - 1;
 			break;
 
 		// 光标定位（行从1开始）
-		case 'H':
-			cursory = (p1 > 0) ? MIN(cell_lines - 1, p1 - 1) : 0;
-			cursorx = (p2 > 0) ? MIN(cell_cols - 1, p2 - 1) : 0;
+		case 'H': // CUP
+		case 'f': // HVP
+			ut->cursory = MIN(lines, n) - 1;
+			ut->cursorx = MIN(cols, uterm_param(ut, 1, 1)) - 1;
 			break;
 
 		// 清屏
-		case 'J':
-			if (p1 == 2) { // 清除整个屏幕
-				memset(back_buffer->cell, 0, cell_count * sizeof(char));
-				// 使用当前背景色填充整个屏幕
-				for (size_t i = 0; i < term_width * term_height; ++i) {
-				    back_buffer->fb[i] = vtcontrol->current_bg;
-				}
-				cursorx = cursory = 0;
+		case 'J': // ED
+			switch (uterm_param(ut, 0, 0)) {
+				case 0: // 光标到屏幕末尾
+					uterm_blank_range(ut, y, x, cols);
+					for (int i = y + 1; i < lines; i++) uterm_blank_range(ut, i, 0, cols);
+					break;
+				case 1: // 屏幕开头到光标
+					for (int i = 0; i < y; i++) uterm_blank_range(ut, i, 0, cols);
+					uterm_blank_range(ut, y, 0, x + 1);
+					break;
+				case 2: // 整个屏幕
+					for (int i = 0; i < lines; i++) uterm_blank_range(ut, i, 0, cols);
+					break;
+				case 3: // 回滚缓冲（xterm）
+					uscrollback_clear(&ut->scrollback);
+					break;
 			}
 			break;
 
 		// 清除行
-		case 'K':
-			if (p1 == 0 || p1 == 1) { // 清除从光标到行尾/行首
-				int start = (p1 == 0) ? cursorx : 0;
-				int end = (p1 == 0) ? cell_cols : cursorx + 1;
-				for (int x = start; x < end; x++) {
-					uterm_cell_putc(' ', x, cursory);
-				}
-			} else if (p1 == 2) { // 清除整行
-				for (int x = 0; x < cell_cols; x++) {
-					uterm_cell_putc(' ', x, cursory);
-				}
+		case 'K': // EL
+			switch (uterm_param(ut, 0, 0)) {
+				case 0: uterm_blank_range(ut, y, x, cols); break;   // 光标到行尾
+				case 1: uterm_blank_range(ut, y, 0, x + 1); break;  // 行首到光标
+				case 2: uterm_blank_range(ut, y, 0, cols); break;   // 整行
 			}
 			break;
-		case 'm':
-			handle_ansi_sgr();
+		case 'X': // ECH 清除字符
+			uterm_blank_range(ut, y, x, x + n);
+			break;
+
+		// 插入/删除：移动已绘制的单元，只有空出的单元需要光栅化
+		case '@': // ICH 插入空白字符
+		case 'P': { // DCH 删除字符
+			ucell_t *line = uterm_line(ut, ut->back_buffer.cell, y);
+			n = MIN(n, cols - x);
+			if (final == '@') {
+				uterm_split_wide(ut, line, x, x, y);
+				uterm_move_cells(ut, y, x + n, x, cols - x - n);
+				uterm_clear_cells(ut, line, x, x + n, y);
+				if (line[cols - 1].attr & UCELL_ATTR_WIDE) uterm_clear_cells(ut, line, cols - 1, cols, y); // 右半部分被挤出
+			} else {
+				uterm_split_wide(ut, line, x, x + n, y);
+				uterm_move_cells(ut, y, x, x + n, cols - x - n);
+				uterm_clear_cells(ut, line, cols - n, cols, y);
+			}
+			break;
+		}
+		case 'L': // IL 插入行
+			if (!uterm_in_region(ut, y)) break;
+			n = MIN(n, (int) ut->scroll_bottom - y);
+			uterm_move_lines(ut, y, y + n, ut->scroll_bottom);
+			ut->cursorx = 0;
+			break;
+		case 'M': // DL 删除行
+			if (!uterm_in_region(ut, y)) break;
+			n = MIN(n, (int) ut->scroll_bottom - y);
+			uterm_move_lines(ut, y + n, y, ut->scroll_bottom);
+			ut->cursorx = 0;
+			break;
+		case 'S': // SU 向上滚动
+			uterm_scroll_up(ut, n);
+			break;
+		case 'T': // SD 向下滚动
+			uterm_scroll_down(ut, n);
+			break;
+		case 'r': { // DECSTBM 设置滚动区域，至少两行
+			int top = uterm_param(ut, 0, 1);
+			int bottom = MIN(uterm_param(ut, 1, lines), lines);
+			if (top >= bottom) break;
+			ut->scroll_top = top - 1;
+			ut->scroll_bottom = bottom;
+			ut->cursorx = ut->cursory = 0;
+			break;
+		}
+
+		case 'm': // SGR
+			handle_ansi_sgr(ut);
+			break;
+		case 's': // SCOSC
+			uterm_save_cursor(ut);
+			break;
+		case 'u': // SCORC
+			uterm_restore_cursor(ut);
+			break;
+		default: // 其它命令（DSR、DA 等）需要应答通道，忽略
 			break;
 	}
+}
+
+static void handle_esc_dispatch(uterm_t *ut, uint8_t final) {
+	if (ut->vtcontrol.intermediate_count > 0) return; // 字符集选择等，忽略
 
-	uterm_show_cursor(1); // 显示新光标
-	uterm_putcursor();
+	switch (final) {
+		case '7': // DECSC
+			uterm_save_cursor(ut);
+			break;
+		case '8': // DECRC
+			uterm_restore_cursor(ut);
+			break;
+		case 'D': // IND
+			uterm_index(ut);
+			break;
+		case 'E': // NEL
+			ut->cursorx = 0;
+			uterm_index(ut);
+			break;
+		case 'M': // RI
+			uterm_reverse_index(ut);
+			break;
+		case 'c': // RIS
+			uterm_reset_attr(ut);
+			ut->scroll_top = 0;
+			ut->scroll_bottom = ut->cell_lines;
+			for (uint32_t i = 0; i < ut->cell_lines; i++) uterm_blank_range(ut, i, 0, ut->cell_cols);
+			ut->cursorx = ut->cursory = 0;
+			ut->cursor_visible = 1;
+			break;
+	}
 }
 
-static void handle_backspace() {
-	int original_x = cursorx;
-	int original_y = cursory;
+static void handle_backspace(uterm_t *ut) {
+	uint32_t original_x = ut->cursorx;
+	uint32_t original_y = ut->cursory;
 
-	cursorx--;
-	if (cursorx < 0) {
-		cursory = MAX(0, cursory - 1);
-		cursorx = cell_cols - 1;
+	if (ut->cursorx > 0) {
+		ut->cursorx--;
+	} else if (ut->cursory > 0) {
+		ut->cursory--;
+		ut->cursorx = ut->cell_cols - 1;
 	}
 
-	if (original_y >= 0 && original_x >= 0) {
-		uterm_cell_putc(' ', original_x, original_y); // 使用当前背景色
+	uterm_blank_range(ut, original_y, original_x, original_x + 1); // 使用当前背景色
+}
+
+/* 可以直接填充的空白单元，*color 为填充的颜色 */
+static inline int uterm_cell_fill(uterm_t *ut, const ucell_t *c, uint32_t *color) {
+	if (!ut->blank_fill || (c->ch != 0 && c->ch != ' ') || (c->attr & UCELL_ATTR_UNDERLINE)) return 0;
+	*color = (c->attr & UCELL_ATTR_REVERSE) ? c->fg : c->bg;
+	return 1;
+}
+
+/* 把物理行 y 上 [x, x + n) 的单元填充为 color，并标记为损坏 */
+static void uterm_fill_cells(uterm_t *ut, uint32_t x, uint32_t n, uint32_t y, uint32_t screen_y, uint32_t color) {
+	uint8_t *dst = ut->back_buffer.fb + y * UGLYPH_HEIGHT * ut->pitch + x * UGLYPH_WIDTH * ut->bpp;
+
+	ufill_rect(dst, ut->pitch, n * UGLYPH_WIDTH * ut->bpp, UGLYPH_HEIGHT, ufill_pattern(color, ut->bpp));
+	uterm_mark_damage(ut, x, x + n, screen_y);
+}
+
+/* 前缓冲的内容未知，所有单元在下一次光栅化时重新绘制 */
+static void uterm_invalidate_front(uterm_t *ut) {
+	for (uint32_t i = 0; i < ut->cell_count; i++) {
+		ut->front_buffer.cell[i].attr = UCELL_ATTR_INVALID;
 	}
 }
 
-/* Swap buffers */
-static void swap_buffers() {
-	int start_line = 0, end_line = 0;
-	int y_start = 0, y_end = 0;
-
-	if (back_buffer->dirty_start <= back_buffer->dirty_end) {
-		start_line =  back_buffer->dirty_start;
-		end_line = back_buffer->dirty_end + 1;
-
-		for (int l = start_line; l < end_line; l++) {
-			y_start = l * 16;
-			y_end = y_start + 16;
-
-			for (int y = y_start; y < y_end; y++) {
-				memcpy(
-					front_buffer->fb + y * term_width,
-					back_buffer->fb + y * term_width,
-					term_width * sizeof(uint32_t)
-				);
+/*
+ * 光栅化物理行 y 上修改位图中的单元。只有内容与已绘制内容
+ * （front_buffer->cell）不同的单元才会重新绘制到后缓冲。
+ * 相邻的、颜色相同的空白单元（清屏、清行后）合并为一段直接填充。
+ * 不同的行互不影响，可以在多个线程上同时进行。
+ * 返回绘制的字形数，*filled 加上填充的空白单元数。
+ */
+static uint32_t uterm_rasterize_row(uterm_t *ut, uglyph_cache_t *cache, uint32_t y, uint32_t *filled) {
+	uint32_t *row = ut->back_buffer.changed + y * ut->bitmap_stride;
+	uint32_t drawn = 0;
+	uint32_t run_x = 0, run_n = 0, run_color = 0; // 待填充的空白段
+	uint32_t screen_y = (y >= ut->row_origin) ? y - ut->row_origin : y + ut->cell_lines - ut->row_origin;
+
+	for (uint32_t w = 0; w < ut->bitmap_stride; w++) {
+		uint32_t bits = row[w];
+		row[w] = 0;
+
+		while (bits) {
+			uint32_t x = (w << 5) + __builtin_ctz(bits);
+			bits &= bits - 1;
+
+			ucell_t *want = &ut->back_buffer.cell[y * ut->cell_cols + x];
+			ucell_t *shown = &ut->front_buffer.cell[y * ut->cell_cols + x];
+			if (memcmp(want, shown, sizeof(ucell_t)) == 0) continue; // 内容未变
+
+			*shown = *want;
+
+			uint32_t color;
+			if (uterm_cell_fill(ut, want, &color)) {
+				(*filled)++;
+				if (run_n && x == run_x + run_n && color == run_color) {
+					run_n++;
+					continue;
+				}
+				if (run_n) uterm_fill_cells(ut, run_x, run_n, y, screen_y, run_color);
+				run_x = x;
+				run_n = 1;
+				run_color = color;
+				continue;
 			}
+
+			uterm_render_cell(ut, cache, ut->back_buffer.fb, want, x, y, 0);
+			uterm_mark_damage(ut, x, x + 1, screen_y);
+			drawn++;
 		}
+	}
+	if (run_n) uterm_fill_cells(ut, run_x, run_n, y, screen_y, run_color);
+	return drawn;
+}
 
-		back_buffer->dirty_start = cell_lines;
-		back_buffer->dirty_end = -1;
+/* 光栅化 raster_rows 中的 [start, end) */
+static void uterm_rasterize_rows(uterm_t *ut, uglyph_cache_t *cache, uint32_t start, uint32_t end) {
+	uint32_t drawn = 0, filled = 0;
+
+	for (uint32_t i = start; i < end; i++) {
+		drawn += uterm_rasterize_row(ut, cache, ut->raster_rows[i], &filled);
 	}
+	USTAT_ATOMIC_ADD(ut, glyphs, drawn);
+	USTAT_ATOMIC_ADD(ut, fills, filled);
+	USTAT_ATOMIC_ADD(ut, back_pixels, (uint64_t) (drawn + filled) * UGLYPH_PIXELS);
+	(void) drawn;
+}
+
+/* 工作线程任务：第 band 段的行，每段使用自己的字形缓存 */
+static void uterm_rasterize_band(void *arg, int band) {
+	uterm_t *ut = (uterm_t *) arg;
+	int nbands = ut->workers.nworkers + 1;
+	uint32_t start = ut->raster_count * band / nbands;
+	uint32_t end = ut->raster_count * (band + 1) / nbands;
 
-	front_buffer->cell[saved_cursor_celly * cell_cols + saved_cursor_cellx] = 
-		back_buffer->cell[saved_cursor_celly * cell_cols + saved_cursor_cellx];
+	uterm_rasterize_rows(ut, band ? &ut->worker_caches[band - 1] : &ut->glyph_cache, start, end);
 }
 
-static void uterm_putcursor() {
-	if (cursorx >= cell_cols) {
-		cursorx = 0;
-		cursory++;
-		if (cursory >= cell_lines) {
-			uterm_scroll();
-			cursory = cell_lines - 1;
+static void uterm_rasterize(uterm_t *ut) {
+	ut->raster_count = 0;
+	for (uint32_t y = 0; y < ut->cell_lines; y++) { // y 为物理行
+		const uint32_t *row = ut->back_buffer.changed + y * ut->bitmap_stride;
+		for (uint32_t w = 0; w < ut->bitmap_stride; w++) {
+			if (row[w]) {
+				ut->raster_rows[ut->raster_count++] = y;
+				break;
+			}
 		}
 	}
-	// 使用当前背景色作为前景，前景色作为背景来反转光标
-	uterm_cell_putc_raw(' ', cursorx, cursory, vtcontrol->current_bg, vtcontrol->current_fg);
+
+	if (ut->workers.nworkers > 0 && ut->raster_count >= UTERM_PARALLEL_MIN_ROWS) {
+		uworker_pool_run(&ut->workers, uterm_rasterize_band, ut);
+		return;
+	}
+
+	uterm_rasterize_rows(ut, &ut->glyph_cache, 0, ut->raster_count);
 }
 
-void uterm_show_cursor(int show) {
-	if (cursor_visible) {
-		// 恢复原字符颜色到旧光标位置
-		char ch = back_buffer->cell[saved_cursor_celly * cell_cols + saved_cursor_cellx];
-		uterm_cell_putc(ch, saved_cursor_cellx, saved_cursor_celly);
+/* 把屏幕第 celly 行的 [cellx, cellx + n) 个单元从后缓冲复制到前缓冲，两者格式相同，按字节复制 */
+static void uterm_copy_span_front(uterm_t *ut, int cellx, int celly, int n) {
+	int start_x = cellx * UGLYPH_WIDTH;
+	uint8_t *dst = ut->front_buffer.fb + celly * UGLYPH_HEIGHT * ut->pitch;
+	uint8_t *src = ut->back_buffer.fb + uterm_phys_row(ut, celly) * UGLYPH_HEIGHT * ut->pitch;
+
+	if (ut->damage) ut->damage(start_x, celly * UGLYPH_HEIGHT, n * UGLYPH_WIDTH, UGLYPH_HEIGHT);
+	USTAT_ADD(ut, front_pixels, (uint64_t) n * UGLYPH_PIXELS);
+
+	if ((uint32_t) n == ut->cell_cols && ut->term_width == ut->cell_cols * UGLYPH_WIDTH) { // 整行连续，一次复制
+		memcpy(dst, src, UGLYPH_HEIGHT * ut->pitch);
+		return;
 	}
-	if (show) {
-		// 保存新位置并绘制反转颜色
-		saved_cursor_cellx = cursorx;
-		saved_cursor_celly = cursory;
-		char ch = back_buffer->cell[cursory * cell_cols + cursorx];
-		uterm_cell_putc_raw(ch, cursorx, cursory, vtcontrol->current_bg, vtcontrol->current_fg);
-		cursor_visible = 1;
-	} else {
-		cursor_visible = 0;
+
+	for (int y = 0; y < UGLYPH_HEIGHT; y++) {
+		memcpy(
+			dst + y * ut->pitch + start_x * ut->bpp,
+			src + y * ut->pitch + start_x * ut->bpp,
+			n * UGLYPH_WIDTH * ut->bpp
+		);
 	}
 }
 
-void init_uterm(uint32_t *vram, ssize_t width, ssize_t height, void *(*malloc)(size_t), void (*free)(void*)){
-	cell_cols = width / 8;
-	cell_lines = height / 16;
-	cell_count = cell_cols * cell_lines;
+/*
+ * 双页显示：本次的损坏合并到两页各自的位图中，前缓冲指向隐藏页，
+ * 返回隐藏页需要复制的位图。隐藏页上旧的光标也需要恢复。
+ */
+static uint32_t *uterm_page_prepare(uterm_t *ut) {
+	int hidden = ut->page ^ 1;
+	uint32_t *dmg = ut->page_damage[hidden];
+	uint32_t *shown = ut->page_damage[ut->page];
+	uint32_t *src = ut->back_buffer.damage;
+
+	for (uint32_t i = 0; i < ut->cell_lines * ut->bitmap_stride; i++) {
+		dmg[i] |= src[i];
+		shown[i] |= src[i];
+		src[i] = 0;
+	}
 
-	term_width = width;
-	term_height = height;
+	if (ut->page_cursor_drawn[hidden]) {
+		uint32_t x = ut->page_cursor[hidden][0];
+		uterm_bitmap_set(ut, dmg, x, x + 1, ut->page_cursor[hidden][1]);
+	}
 
-	umalloc = malloc;
-	ufree = free;
+	ut->front_buffer.fb = ut->pages[hidden];
+	return dmg;
+}
 
-	uframebuffer = vram;
+static void uterm_page_present(uterm_t *ut) {
+	int hidden = ut->page ^ 1;
 
-	front_buffer = (ubuffer_t *) umalloc(sizeof(ubuffer_t));
-	back_buffer = (ubuffer_t *) umalloc(sizeof(ubuffer_t));
+	ut->page_cursor_drawn[hidden] = ut->cursor_drawn;
+	ut->page_cursor[hidden][0] = ut->saved_cursor_cellx;
+	ut->page_cursor[hidden][1] = ut->saved_cursor_celly;
 
-	// 初始化 front_buffer（指向显存）
-	front_buffer->fb = uframebuffer;
-	front_buffer->cell = (char *) umalloc(cell_lines * cell_cols * sizeof(char));
-	memset(front_buffer->cell, 0, cell_lines * cell_cols * sizeof(char));
+	ut->present(hidden); // 返回时翻页已生效，原来显示的页可以重新绘制
+	ut->page = hidden;
+}
+
+/* Swap buffers */
+static void swap_buffers(uterm_t *ut) {
+	uint32_t *damage = ut->back_buffer.damage;
+	uint64_t start = USTAT_NOW(ut);
+
+	uterm_rasterize(ut);
+	USTAT_TIME(ut, render_time, start);
+	start = USTAT_NOW(ut);
+
+	int cursor_redraw = uterm_cursor_prepare(ut);
+	if (ut->present) {
+		damage = uterm_page_prepare(ut);
+		cursor_redraw = 1; // 隐藏页上的光标总是重绘
+	}
 
-	vtcontrol = (vt100_t *) umalloc(sizeof(vt100_t)); // 只分配一次
+	// 只复制损坏的单元到前缓冲
+	for (uint32_t y = 0; y < ut->cell_lines; y++) {
+		uint32_t *row = damage + y * ut->bitmap_stride;
+		uint32_t x = uterm_bitmap_find(ut, row, 0, 1);
 
-	vtcontrol->current_fg = ansi_to_rgba(ANSI_COLOR_WHITE, 0); // 默认前景色
-	vtcontrol->current_bg = ansi_to_rgba(ANSI_COLOR_BLACK, 0); // 默认背景色
+		while (x < ut->cell_cols) {
+			uint32_t end = uterm_bitmap_find(ut, row, x, 0);
+			uterm_copy_span_front(ut, x, y, end - x);
+			x = uterm_bitmap_find(ut, row, end, 1);
+		}
+		memset(row, 0, ut->bitmap_stride * sizeof(uint32_t));
+	}
 
-	// 初始化 back_buffer（离屏缓冲）
-	back_buffer->fb = (uint32_t *) umalloc(term_width * term_height * sizeof(uint32_t));
-	back_buffer->cell = (char *) umalloc(cell_lines * cell_cols * sizeof(char));
-	memset(back_buffer->fb, 0, term_width * term_height * sizeof(uint32_t));
-	memset(back_buffer->cell, 0, cell_lines * cell_cols * sizeof(char));
-	back_buffer->dirty_start = 0; // 初始为整个屏幕脏
-	back_buffer->dirty_end = cell_lines - 1; // 结束行
+	if (cursor_redraw) uterm_overlay_cursor(ut);
+	if (ut->present) uterm_page_present(ut);
+	USTAT_TIME(ut, present_time, start);
+	USTAT_ADD(ut, flushes, 1);
+}
 
-	uterm_putcursor();
+/*
+ * 光标只叠加在前缓冲上，后缓冲中光标下的字符不会被改动。
+ * 需要重绘光标时返回 1，并把旧光标所在单元标记为损坏以便复制时恢复。
+ */
+static int uterm_cursor_prepare(uterm_t *ut) {
+	int moved = ut->saved_cursor_cellx != ut->cursorx || ut->saved_cursor_celly != ut->cursory;
+	int redraw = !ut->cursor_drawn || !ut->cursor_visible || moved ||
+		(ut->cursorx < ut->cell_cols && ut->cursory < ut->cell_lines && uterm_is_damaged(ut, ut->cursorx, ut->cursory));
+
+	if (ut->cursor_drawn && redraw) {
+		uterm_mark_damage(ut, ut->saved_cursor_cellx, ut->saved_cursor_cellx + 1, ut->saved_cursor_celly); // 恢复旧光标处的字符
+	}
+	return redraw;
 }
 
-void uterm_draw_pix(int x, int y, uint32_t rgba){
-	back_buffer->fb[y * term_width + x] = rgba;
+static void uterm_overlay_cursor(uterm_t *ut) {
+	ut->cursor_drawn = 0;
 
-	return;
+	if (!ut->cursor_visible || ut->cursorx >= ut->cell_cols || ut->cursory >= ut->cell_lines) return;
+
+	// 反转光标下单元的前景色和背景色
+	uterm_render_cell(ut, &ut->glyph_cache, ut->front_buffer.fb, &uterm_line(ut, ut->front_buffer.cell, ut->cursory)[ut->cursorx], ut->cursorx, ut->cursory, 1);
+	if (ut->damage) ut->damage(ut->cursorx * UGLYPH_WIDTH, ut->cursory * UGLYPH_HEIGHT, UGLYPH_WIDTH, UGLYPH_HEIGHT);
+	USTAT_ADD(ut, front_pixels, UGLYPH_PIXELS);
+	ut->saved_cursor_cellx = ut->cursorx;
+	ut->saved_cursor_celly = ut->cursory;
+	ut->cursor_drawn = 1;
 }
 
-void uterm_cell_putc_raw(char ch, int cellx, int celly, uint32_t rgbaF, uint32_t rgbaB) {
-	if (cellx < 0 || cellx >= cell_cols || celly < 0 || celly >= cell_lines) return;
+void uterm_ctx_show_cursor(uterm_t *ut, int show) {
+	ut->cursor_visible = show ? 1 : 0; // 在下一次 uterm_flush 时生效
+}
 
-	uint8_t *font = ascfont + ch * 16;
-	int start_x = cellx * 8;
-	int start_y = celly * 16;
+/* 字形缓存预算平均分给调用线程和每个工作线程 */
+static void uterm_init_caches(uterm_t *ut) {
+	int n = ut->workers.nworkers;
+	size_t budget = ut->glyph_cache_budget / (n + 1);
 
-	// 添加对start_x和start_y的边界检查
-	if ((start_x+8) > term_width || (start_y+16) > term_height) return;
-	back_buffer->cell[celly * cell_cols + cellx] = ch;
+	uglyph_cache_init(&ut->glyph_cache, budget, ut->bpp, ut->umalloc);
+	if (n > 0) {
+		ut->worker_caches = (uglyph_cache_t *) ut->umalloc(n * sizeof(uglyph_cache_t));
+		for (int i = 0; i < n; i++) {
+			uglyph_cache_init(&ut->worker_caches[i], budget, ut->bpp, ut->umalloc);
+		}
+	}
+}
 
-	for (int i = 0; i < 16; i++) {
-		uint8_t row = font[i];
-		uint32_t *fb_row = &back_buffer->fb[(start_y + i) * term_width + start_x];
-		fb_row[0] = (row & 0x80) ? rgbaF : rgbaB;
-		fb_row[1] = (row & 0x40) ? rgbaF : rgbaB;
-		fb_row[2] = (row & 0x20) ? rgbaF : rgbaB;
-		fb_row[3] = (row & 0x10) ? rgbaF : rgbaB;
-		fb_row[4] = (row & 0x08) ? rgbaF : rgbaB;
-		fb_row[5] = (row & 0x04) ? rgbaF : rgbaB;
-		fb_row[6] = (row & 0x02) ? rgbaF : rgbaB;
-		fb_row[7] = (row & 0x01) ? rgbaF : rgbaB;
+static void uterm_destroy_caches(uterm_t *ut) {
+	uglyph_cache_destroy(&ut->glyph_cache, ut->ufree);
+	if (ut->worker_caches) {
+		for (int i = 0; i < ut->workers.nworkers; i++) {
+			uglyph_cache_destroy(&ut->worker_caches[i], ut->ufree);
+		}
+		ut->ufree(ut->worker_caches);
+		ut->worker_caches = NULL;
 	}
 }
 
-void uterm_cell_putc(char ch, int cellx, int celly) {
-	if (cellx < 0 || cellx >= cell_cols || celly < 0 || celly >= cell_lines) return;
+uterm_t *uterm_ctx_create(uint32_t *vram, ssize_t width, ssize_t height, void *(*malloc)(size_t), void (*free)(void*)){
+	uterm_t *ut = (uterm_t *) malloc(sizeof(uterm_t));
+	memset(ut, 0, sizeof(uterm_t));
+
+	ut->cell_cols = width / UGLYPH_WIDTH;
+	ut->cell_lines = height / UGLYPH_HEIGHT;
+	ut->cell_count = ut->cell_cols * ut->cell_lines;
+	ut->bitmap_stride = (ut->cell_cols + 31) / 32;
+	ut->row_origin = 0;
+	ut->scroll_top = 0;
+	ut->scroll_bottom = ut->cell_lines;
+
+	ut->term_width = width;
+	ut->term_height = height;
+
+	ut->umalloc = malloc;
+	ut->ufree = free;
+
+	ut->format = UTERM_FORMAT_RGBA8888;
+	ut->bpp = upixel_bytes(ut->format);
+	ut->pitch = ut->term_width * ut->bpp;
+	uterm_build_palette(ut);
+
+	ut->vtcontrol.state = UVT_GROUND;
+	ut->vtcontrol.current_fg = ansi_color(ut, ANSI_COLOR_WHITE, 0); // 默认前景色
+	ut->vtcontrol.current_bg = ansi_color(ut, ANSI_COLOR_BLACK, 0); // 默认背景色
+
+	// 初始化 front_buffer（指向显存），cell 记录已绘制的内容
+	ut->front_buffer.fb = (uint8_t *) vram;
+	ut->front_buffer.cell = (ucell_t *) ut->umalloc(ut->cell_count * sizeof(ucell_t));
+	ut->front_buffer.changed = NULL;
+	ut->front_buffer.damage = NULL;
+	for (uint32_t i = 0; i < ut->cell_count; i++) {
+		ut->front_buffer.cell[i].attr = UCELL_ATTR_INVALID; // 首次 flush 时全部绘制
+	}
 
-	uint8_t *font = ascfont + ch * 16;
-	int start_x = cellx * 8;
-	int start_y = celly * 16;
+	// 初始化 back_buffer（离屏缓冲），cell 记录期望的内容
+	ut->back_buffer.fb = (uint8_t *) ut->umalloc(ut->term_height * ut->pitch);
+	ut->back_buffer.cell = (ucell_t *) ut->umalloc(ut->cell_count * sizeof(ucell_t));
+	ut->back_buffer.changed = (uint32_t *) ut->umalloc(ut->cell_lines * ut->bitmap_stride * sizeof(uint32_t));
+	ut->back_buffer.damage = (uint32_t *) ut->umalloc(ut->cell_lines * ut->bitmap_stride * sizeof(uint32_t));
+	ut->raster_rows = (uint32_t *) ut->umalloc(ut->cell_lines * sizeof(uint32_t));
+	memset(ut->back_buffer.fb, 0, ut->term_height * ut->pitch);
+	memset(ut->back_buffer.changed, 0, ut->cell_lines * ut->bitmap_stride * sizeof(uint32_t));
+	memset(ut->back_buffer.damage, 0, ut->cell_lines * ut->bitmap_stride * sizeof(uint32_t));
+	for (uint32_t i = 0; i < ut->cell_count; i++) {
+		uterm_blank_cell(ut, &ut->back_buffer.cell[i]);
+	}
+	for (uint32_t y = 0; y < ut->cell_lines; y++) {
+		uterm_mark_changed(ut, 0, ut->cell_cols, y);
+		uterm_mark_damage(ut, 0, ut->cell_cols, y); // 初始为整个屏幕损坏
+	}
 
-	back_buffer->cell[celly * cell_cols + cellx] = ch;
+	uglyph_select_kernel(); // 所有上下文选择相同的内核
+	uscan_select_kernel();
+	ufill_select_kernel();
 
-	// 使用当前颜色设置
-	uint32_t rgbaF = vtcontrol->current_fg;
-	uint32_t rgbaB = vtcontrol->current_bg;
+	// 内嵌字体为 8x16，单元尺寸不同时在光栅化时缩放
+	ufont_raw(&ut->font, ascfont, ascfont_count, 8, 16);
+	uglyph_map_init(&ut->glyph_map, uglyph_scan_pairs, ascfont_unicode, ascfont_unicode_count, ut->umalloc);
+	uterm_check_blank(ut);
+	ut->glyph_cache_budget = UGLYPH_CACHE_DEFAULT;
+	uterm_init_caches(ut);
 
-	// if (vtcontrol->bold) {
-	// 	rgbaF = brighten_color(rgbaF);
-	// }
+	uring_init(&ut->input, URING_SIZE_DEFAULT, URING_DROP_OLDEST, ut->umalloc);
 
-	for (int i = 0; i < 16; i++) {
-		for (int j = 0; j < 8; j++) {
-			int x = start_x + j;
-			int y = start_y + i;
-			uint32_t color = (font[i] & (0x80 >> j)) ? rgbaF : rgbaB;
-			back_buffer->fb[y * term_width + x] = color;
+	uscrollback_init(&ut->scrollback, USCROLLBACK_DEFAULT, ut->cell_cols, ut->umalloc);
+	ut->history_row = (ucell_t *) ut->umalloc(ut->cell_cols * sizeof(ucell_t));
+
+	ut->cursor_visible = 1;
+	ut->cursor_drawn = 0;
+
+	return ut;
+}
+
+void uterm_ctx_set_glyph_cache(uterm_t *ut, size_t budget) {
+	uterm_destroy_caches(ut);
+	ut->glyph_cache_budget = budget;
+	uterm_init_caches(ut);
+}
+
+void uterm_ctx_glyph_cache_stats(uterm_t *ut, uint64_t *hits, uint64_t *misses) {
+	uint64_t h = ut->glyph_cache.hits;
+	uint64_t m = ut->glyph_cache.misses;
+
+	for (int i = 0; i < ut->workers.nworkers; i++) {
+		h += ut->worker_caches[i].hits;
+		m += ut->worker_caches[i].misses;
+	}
+	if (hits) *hits = h;
+	if (misses) *misses = m;
+}
+
+int uterm_ctx_set_workers(uterm_t *ut, int workers, int (*spawn)(void (*entry)(void *), void *arg)) {
+	int ret;
+
+	uterm_destroy_caches(ut);
+	uworker_pool_stop(&ut->workers, ut->ufree);
+
+	ret = uworker_pool_start(&ut->workers, workers, spawn, ut->umalloc, ut->ufree);
+	uterm_init_caches(ut);
+	return ret;
+}
+
+static void uterm_release_font_file(uterm_t *ut) {
+#ifdef UTERM_MMAP
+	if (ut->font_file) ufont_unmap_file(ut->font_file, ut->font_file_size);
+#endif
+	ut->font_file = NULL;
+	ut->font_file_size = 0;
+}
+
+/* 光栅化时只读码点表，在调用线程上为已有的单元建立页 */
+static void uterm_map_cells(uterm_t *ut, const ucell_t *cells, uint32_t n) {
+	for (uint32_t i = 0; i < n; i++) {
+		uglyph_map_get(&ut->glyph_map, cells[i].ch, ut->umalloc);
+	}
+}
+
+/* 空白字形（包括 ' '）没有点时，空白单元直接填充颜色，不经过字形展开 */
+static void uterm_check_blank(uterm_t *ut) {
+	uint8_t fitted[UGLYPH_BYTES];
+	uint32_t blank = ut->glyph_map.blank;
+	const uint8_t *bits;
+
+	ut->blank_fill = 0;
+	if (blank >= ut->font.count || (ut->glyph_map.pages[0][' '] & UGLYPH_MAP_INDEX) != blank) return;
+
+	bits = ufont_native(&ut->font, blank, UFONT_WHOLE);
+	if (!bits) {
+		ufont_fit(&ut->font, blank, UFONT_WHOLE, fitted);
+		bits = fitted;
+	}
+	for (int i = 0; i < UGLYPH_BYTES; i++) {
+		if (bits[i]) return;
+	}
+	ut->blank_fill = 1;
+}
+
+/* 换用 font：重建码点表，清空字形缓存，所有单元在下一次 flush 时重新光栅化 */
+static int uterm_use_font(uterm_t *ut, const ufont_t *font, uglyph_scan_fn scan, const void *source, uint32_t len) {
+	uglyph_map_t map;
+
+	if (uglyph_map_init(&map, scan, source, len, ut->umalloc) != 0) {
+		uglyph_map_destroy(&map, ut->ufree);
+		return -1;
+	}
+	uglyph_map_destroy(&ut->glyph_map, ut->ufree);
+	ut->glyph_map = map;
+	ut->font = *font;
+	uterm_map_cells(ut, ut->back_buffer.cell, ut->cell_count);
+	uterm_check_blank(ut);
+
+	uterm_destroy_caches(ut);
+	uterm_init_caches(ut);
+	uterm_invalidate_front(ut);
+	for (uint32_t y = 0; y < ut->cell_lines; y++) {
+		uterm_mark_changed(ut, 0, ut->cell_cols, y);
+	}
+	return 0;
+}
+
+int uterm_ctx_set_font(uterm_t *ut, const void *psf, size_t size) {
+	ufont_t font;
+	int ret;
+
+	if (!psf) { // 内嵌字体
+		ufont_raw(&font, ascfont, ascfont_count, 8, 16);
+		ret = uterm_use_font(ut, &font, uglyph_scan_pairs, ascfont_unicode, ascfont_unicode_count);
+	} else if (ufont_psf2(&font, psf, size) != 0) {
+		return -1;
+	} else if (font.unicode) {
+		ret = uterm_use_font(ut, &font, ufont_psf2_scan, font.unicode, font.unicode_len);
+	} else {
+		ret = uterm_use_font(ut, &font, ufont_index_scan, NULL, font.count);
+	}
+	if (ret != 0) return -1;
+
+	uterm_release_font_file(ut); // 之前映射的文件不再使用
+	return 0;
+}
+
+int uterm_ctx_load_font(uterm_t *ut, const char *path) {
+#ifdef UTERM_MMAP
+	size_t size;
+	const void *data = ufont_map_file(path, &size);
+
+	if (!data) return -1;
+	if (uterm_ctx_set_font(ut, data, size) != 0) {
+		ufont_unmap_file(data, size);
+		return -1;
+	}
+	ut->font_file = data;
+	ut->font_file_size = size;
+	return 0;
+#else
+	(void) ut;
+	(void) path;
+	return -1;
+#endif
+}
+
+static inline uint32_t uterm_convert_color(int from, int to, uint32_t pixel) {
+	return upixel_from_rgba(to, upixel_to_rgba(from, pixel));
+}
+
+/*
+ * 换用像素格式：单元和当前属性中的颜色换算到新格式，后缓冲和字形缓存
+ * 按新的像素宽度重新分配，整个屏幕在下一次 flush 时重新绘制。
+ * 回滚缓冲中的颜色仍为旧格式，直接清空。
+ */
+int uterm_ctx_set_format(uterm_t *ut, int format) {
+	uint32_t bpp = upixel_bytes(format);
+	int from = ut->format;
+	vt100_t *vt = &ut->vtcontrol;
+
+	if (bpp == 0) return -1;
+	if (format == from) return 0;
+
+	uint8_t *fb = (uint8_t *) ut->umalloc(ut->term_height * ut->term_width * bpp);
+	if (!fb) return -1;
+	memset(fb, 0, ut->term_height * ut->term_width * bpp);
+	ut->ufree(ut->back_buffer.fb);
+	ut->back_buffer.fb = fb;
+
+	for (uint32_t i = 0; i < ut->cell_count; i++) {
+		ucell_t *c = &ut->back_buffer.cell[i];
+		c->fg = uterm_convert_color(from, format, c->fg);
+		c->bg = uterm_convert_color(from, format, c->bg);
+	}
+	uterm_invalidate_front(ut);
+	vt->current_fg = uterm_convert_color(from, format, vt->current_fg);
+	vt->current_bg = uterm_convert_color(from, format, vt->current_bg);
+	vt->saved_fg = uterm_convert_color(from, format, vt->saved_fg);
+	vt->saved_bg = uterm_convert_color(from, format, vt->saved_bg);
+
+	ut->format = format;
+	ut->bpp = bpp;
+	ut->pitch = ut->term_width * bpp;
+	uterm_build_palette(ut);
+
+	uterm_destroy_caches(ut);
+	uterm_init_caches(ut);
+	uscrollback_clear(&ut->scrollback);
+
+	for (uint32_t y = 0; y < ut->cell_lines; y++) {
+		uterm_mark_changed(ut, 0, ut->cell_cols, y);
+		uterm_mark_damage(ut, 0, ut->cell_cols, y);
+	}
+	for (int i = 0; i < 2; i++) {
+		if (!ut->page_damage[i]) continue;
+		memset(ut->page_damage[i], 0xFF, ut->cell_lines * ut->bitmap_stride * sizeof(uint32_t));
+		ut->page_cursor_drawn[i] = 0;
+	}
+	ut->cursor_drawn = 0;
+	return 0;
+}
+
+void uterm_ctx_draw_pix(uterm_t *ut, int x, int y, uint32_t rgba){
+	uint8_t *row = ut->back_buffer.fb + (uterm_phys_row(ut, y / UGLYPH_HEIGHT) * UGLYPH_HEIGHT + y % UGLYPH_HEIGHT) * ut->pitch;
+	upixel_fill(row + x * ut->bpp, 1, upixel_from_rgba(ut->format, rgba), ut->bpp);
+
+	return;
+}
+
+/* 图块复制到帧缓冲，每行的长度为常数，按像素宽度分开以便展开为宽存储 */
+static inline void uterm_copy_tile(uint8_t *dst, size_t pitch, const uint8_t *tile, uint32_t bpp) {
+	if (bpp == 2) {
+		for (int i = 0; i < UGLYPH_HEIGHT; i++) {
+			memcpy(dst + i * pitch, tile + i * UGLYPH_WIDTH * 2, UGLYPH_WIDTH * 2);
+		}
+	} else {
+		for (int i = 0; i < UGLYPH_HEIGHT; i++) {
+			memcpy(dst + i * pitch, tile + i * UGLYPH_WIDTH * 4, UGLYPH_WIDTH * 4);
 		}
 	}
+}
 
-	uterm_cell_putc_raw(ch, cellx, celly, rgbaF, rgbaB); // 直接调用优化版本
+/*
+ * 字形尺寸与单元相同时直接从字体数据展开，否则在缓存未命中时
+ * 先缩放到栈上。缓存的键为字形下标和 part。
+ */
+static void uterm_render_glyph(uterm_t *ut, uglyph_cache_t *cache, uint8_t *fb, uint32_t glyph, int part, int cellx, int celly, uint32_t rgbaF, uint32_t rgbaB) {
+	uint8_t fitted[UGLYPH_BYTES];
+
+	if (glyph >= ut->font.count) glyph = 0; // 字体中没有的字形
+	uint32_t key = glyph | (uint32_t) part << 24;
+	const uint8_t *bits = ufont_native(&ut->font, glyph, part);
+	uint8_t *dst = fb + celly * UGLYPH_HEIGHT * ut->pitch + cellx * UGLYPH_WIDTH * ut->bpp;
+	const uint8_t *tile = uglyph_cache_get(cache, bits, key, rgbaF, rgbaB);
+
+	if (!tile && !bits) {
+		ufont_fit(&ut->font, glyph, part, fitted);
+		bits = fitted;
+		tile = uglyph_cache_get(cache, bits, key, rgbaF, rgbaB);
+	}
+	if (!tile) { // 缓存关闭，直接展开
+		uglyph_expand_bpp(dst, ut->term_width, bits, rgbaF, rgbaB, ut->bpp);
+		return;
+	}
 
-	// 更新脏区域
-	if (celly < back_buffer->dirty_start)
-		back_buffer->dirty_start = celly;
-	if (celly > back_buffer->dirty_end)
-		back_buffer->dirty_end = celly;
+	uterm_copy_tile(dst, ut->pitch, tile, ut->bpp);
 }
 
-void uterm_putc(char ch) {
-	uterm_show_cursor(0); // 先隐藏光标
+/* 按单元属性绘制，invert 用于光标反显 */
+static void uterm_render_cell(uterm_t *ut, uglyph_cache_t *cache, uint8_t *fb, const ucell_t *c, int cellx, int celly, int invert) {
+	uint32_t rgbaF = c->fg;
+	uint32_t rgbaB = c->bg;
 
-	/* 处理 ANSI 转义序列状态机 */
-	if (vtcontrol->status > 0) {
-		if (vtcontrol->status == 1) { // 已收到 ESC
-			if (ch == '[') {
-				vtcontrol->status = 2; // 进入 CSI 模式
-				vtcontrol->param_count = 0;
-				memset(vtcontrol->params, 0, sizeof(vtcontrol->params));
-			} else {
-				vtcontrol->status = 0; // 非 CSI 序列，重置
+	if (!(c->attr & UCELL_ATTR_REVERSE) != !invert) {
+		rgbaF = c->bg;
+		rgbaB = c->fg;
+	}
+
+	// 宽字符的两个单元各画字形的一半，字体没有这个字形时右半部分留空
+	uint32_t entry = uglyph_map_find(&ut->glyph_map, c->ch);
+	uint32_t glyph = entry & UGLYPH_MAP_INDEX;
+	int part = UFONT_WHOLE;
+	if (c->attr & (UCELL_ATTR_WIDE | UCELL_ATTR_WIDE_TAIL)) {
+		if (entry & UGLYPH_MAP_FONT) part = (c->attr & UCELL_ATTR_WIDE) ? UFONT_LEFT : UFONT_RIGHT;
+		else if (c->attr & UCELL_ATTR_WIDE_TAIL) glyph = ut->glyph_map.blank;
+	}
+
+	uterm_render_glyph(ut, cache, fb, glyph, part, cellx, celly, rgbaF, rgbaB);
+
+	if (c->attr & UCELL_ATTR_UNDERLINE) {
+		uint8_t *fb_row = fb + (celly * UGLYPH_HEIGHT + UGLYPH_HEIGHT - 1) * ut->pitch + cellx * UGLYPH_WIDTH * ut->bpp;
+		upixel_fill(fb_row, UGLYPH_WIDTH, rgbaF, ut->bpp);
+	}
+}
+
+void uterm_ctx_cell_putc_raw(uterm_t *ut, char ch, int cellx, int celly, uint32_t rgbaF, uint32_t rgbaB) {
+	if (cellx < 0 || (uint32_t) cellx >= ut->cell_cols || celly < 0 || (uint32_t) celly >= ut->cell_lines) return;
+
+	ucell_t *line = uterm_line(ut, ut->back_buffer.cell, celly);
+	ucell_t *c = &line[cellx];
+	uterm_split_wide(ut, line, cellx, cellx + 1, celly);
+	c->ch = (uint8_t) ch; // Latin-1
+	c->fg = upixel_from_rgba(ut->format, rgbaF);
+	c->bg = upixel_from_rgba(ut->format, rgbaB);
+	c->attr = 0;
+	uterm_mark_changed(ut, cellx, cellx + 1, celly); // 在 flush 时光栅化
+}
+
+void uterm_ctx_cell_putc(uterm_t *ut, char ch, int cellx, int celly) {
+	if (cellx < 0 || (uint32_t) cellx >= ut->cell_cols || celly < 0 || (uint32_t) celly >= ut->cell_lines) return;
+
+	// 使用当前颜色和属性设置
+	ucell_t *line = uterm_line(ut, ut->back_buffer.cell, celly);
+	ucell_t *c = &line[cellx];
+	uterm_split_wide(ut, line, cellx, cellx + 1, celly);
+	c->ch = (uint8_t) ch; // Latin-1
+	c->fg = ut->vtcontrol.current_fg;
+	c->bg = ut->vtcontrol.current_bg;
+	c->attr = uterm_current_attr(ut);
+	uterm_mark_changed(ut, cellx, cellx + 1, celly);
+}
+
+/* 光标右移 n 个单元，到行尾时换行 */
+static void uterm_advance(uterm_t *ut, uint32_t n) {
+	ut->cursorx += n;
+	if (ut->cursorx >= ut->cell_cols) {
+		ut->cursorx = 0;
+		uterm_index(ut);
+	}
+}
+
+/* 连续可打印字符：一次写入当前行，返回消耗的字节数 */
+static size_t uterm_put_run(uterm_t *ut, const char *s, size_t len) {
+	size_t n = MIN(len, (size_t) (ut->cell_cols - ut->cursorx));
+	ucell_t *line = uterm_line(ut, ut->back_buffer.cell, ut->cursory);
+	ucell_t *c = &line[ut->cursorx];
+	ucell_t tmpl = {
+		.fg = ut->vtcontrol.current_fg,
+		.bg = ut->vtcontrol.current_bg,
+		.attr = uterm_current_attr(ut),
+	};
+
+	uterm_split_wide(ut, line, ut->cursorx, ut->cursorx + n, ut->cursory);
+	for (size_t i = 0; i < n; i++) {
+		tmpl.ch = (uint8_t) s[i];
+		c[i] = tmpl;
+	}
+	uterm_mark_changed(ut, ut->cursorx, ut->cursorx + n, ut->cursory);
+
+	uterm_advance(ut, n);
+	return n;
+}
+
+/* 写入一个非 ASCII 码点，宽字符占两个单元，零宽字符丢弃 */
+static void uterm_put_codepoint(uterm_t *ut, uint32_t cp) {
+	uint32_t entry = uglyph_map_get(&ut->glyph_map, cp, ut->umalloc);
+	uint32_t width = (entry & UGLYPH_MAP_WIDE) && ut->cell_cols > 1 ? 2 : 1;
+
+	if (entry & UGLYPH_MAP_ZERO) return; // 不能与前一个字符叠加
+
+	if (ut->cursorx + width > ut->cell_cols) { // 行尾放不下，先换行
+		uterm_blank_range(ut, ut->cursory, ut->cursorx, ut->cell_cols);
+		uterm_advance(ut, ut->cell_cols - ut->cursorx);
+	}
+
+	ucell_t *line = uterm_line(ut, ut->back_buffer.cell, ut->cursory);
+	ucell_t tmpl = {
+		.ch = cp,
+		.fg = ut->vtcontrol.current_fg,
+		.bg = ut->vtcontrol.current_bg,
+		.attr = uterm_current_attr(ut),
+	};
+
+	uterm_split_wide(ut, line, ut->cursorx, ut->cursorx + width, ut->cursory);
+	if (width == 2) {
+		line[ut->cursorx] = tmpl;
+		line[ut->cursorx].attr |= UCELL_ATTR_WIDE;
+		line[ut->cursorx + 1] = tmpl;
+		line[ut->cursorx + 1].attr |= UCELL_ATTR_WIDE_TAIL;
+	} else {
+		line[ut->cursorx] = tmpl;
+	}
+	uterm_mark_changed(ut, ut->cursorx, ut->cursorx + width, ut->cursory);
+
+	uterm_advance(ut, width);
+}
+
+/* 未完成的 UTF-8 序列被打断，输出 U+FFFD */
+static void uterm_utf8_abort(uterm_t *ut) {
+	ut->vtcontrol.utf8_need = 0;
+	uterm_put_codepoint(ut, 0xFFFD);
+}
+
+/*
+ * 解码 [p, end) 开头连续的非 ASCII 字节，返回第一个未处理字节的位置。
+ * 序列可以跨越两次写入，状态保存在 vtcontrol 中。
+ * 非法的字节（过长编码、代理、超出 U+10FFFF）各输出一个 U+FFFD。
+ */
+static const uint8_t *uterm_put_utf8(uterm_t *ut, const uint8_t *p, const uint8_t *end) {
+	vt100_t *vt = &ut->vtcontrol;
+
+	while (p < end && *p >= 0x80) {
+		uint8_t ch = *p;
+
+		if (vt->utf8_need) {
+			if (ch < vt->utf8_lower || ch > vt->utf8_upper) { // 重新作为首字节处理
+				uterm_utf8_abort(ut);
+				continue;
 			}
-			return; // 处理完 ESC 后立即返回，避免后续逻辑
+			p++;
+			vt->utf8_cp = (vt->utf8_cp << 6) | (ch & 0x3F);
+			vt->utf8_lower = 0x80;
+			vt->utf8_upper = 0xBF;
+			if (--vt->utf8_need == 0) uterm_put_codepoint(ut, vt->utf8_cp);
+			continue;
 		}
-		else if (vtcontrol->status == 2) { 
-			if (ch >= '0' && ch <= '9') {
-				vtcontrol->params[vtcontrol->param_count] = vtcontrol->params[vtcontrol->param_count] * 10 + (ch - '0');
-			} else if (ch == ';') {
-				if (vtcontrol->param_count < 3) {
-					vtcontrol->param_count++;
-				}
-			} else {
-				// 处理命令字符
-				if (ch == 'm' || ch == 'H' || ch == 'J') { // 仅支持已知命令
-					vtcontrol->command = ch;
-					handle_vt100_command();
-				}
-				vtcontrol->status = 0;
-				return;
-			}
-			return; // 确保所有分支返回
+
+		p++;
+		vt->utf8_lower = 0x80;
+		vt->utf8_upper = 0xBF;
+		switch (ch) {
+			case 0xC2 ... 0xDF:
+				vt->utf8_cp = ch & 0x1F;
+				vt->utf8_need = 1;
+				break;
+			case 0xE0 ... 0xEF:
+				if (ch == 0xE0) vt->utf8_lower = 0xA0;
+				if (ch == 0xED) vt->utf8_upper = 0x9F;
+				vt->utf8_cp = ch & 0x0F;
+				vt->utf8_need = 2;
+				break;
+			case 0xF0 ... 0xF4:
+				if (ch == 0xF0) vt->utf8_lower = 0x90;
+				if (ch == 0xF4) vt->utf8_upper = 0x8F;
+				vt->utf8_cp = ch & 0x07;
+				vt->utf8_need = 3;
+				break;
+			default: // 单独的后续字节或不可能的首字节
+				uterm_put_codepoint(ut, 0xFFFD);
+				break;
 		}
 	}
+	return p;
+}
 
-	/* 正常字符处理 */
+/* C0 控制字符 */
+static void handle_execute(uterm_t *ut, uint8_t ch) {
 	switch (ch) {
 		case '\r':
-			cursorx = 0;
+			ut->cursorx = 0;
 			break;
 
 		case '\n':
-			cursorx = 0;
-			cursory++;
-			if (cursory >= cell_lines) {
-				uterm_scroll();
-				cursory = cell_lines - 1;
-			}
+		case '\v':
+		case '\f':
+			ut->cursorx = 0; // 换行同时回车
+			uterm_index(ut);
 			break;
 
 		case '\b':
-			handle_backspace();
+			handle_backspace(ut);
 			break;
 
-		case '\t':
-			for (int i = 0; i < 4; i++) uterm_putc(' ');
+		case '\t': // 移到下一个制表位（每 8 列），不改写经过的单元
+			ut->cursorx = MIN(ut->cell_cols - 1, (ut->cursorx / 8 + 1) * 8);
 			break;
+	}
+}
 
-		case '\033': // ESC
-			vtcontrol->status = 1;
-			break;
+/* 在 ESC/CSI/OSC/DCS 状态下执行一个动作 */
+static inline void uterm_vt_action(uterm_t *ut, uint8_t action, uint8_t ch) {
+	vt100_t *vt = &ut->vtcontrol;
 
+	switch (action) {
+		case UVT_PRINT: {
+			char c = (char) ch;
+			uterm_put_run(ut, &c, 1);
+			break;
+		}
+		case UVT_EXECUTE:
+			handle_execute(ut, ch);
+			break;
+		case UVT_CLEAR:
+			vt->private_marker = 0;
+			vt->intermediate_count = 0;
+			vt->param_count = 0;
+			vt->params[0] = 0; // 没有参数时按默认值 0 读取
+			vt->param_sub = 0;
+			vt->param_overflow = 0;
+			break;
+		case UVT_COLLECT:
+			if (ch >= 0x3C && ch <= 0x3F) {
+				vt->private_marker = ch;
+			} else if (vt->intermediate_count < UVT_MAX_INTERMEDIATES) {
+				vt->intermediates[vt->intermediate_count++] = ch;
+			}
+			break;
+		case UVT_PARAM:
+			if (vt->param_count == 0) vt->params[vt->param_count++] = 0;
+			if (ch == ';' || ch == ':') {
+				if (vt->param_count < UVT_MAX_PARAMS) {
+					if (ch == ':') vt->param_sub |= 1u << vt->param_count;
+					vt->params[vt->param_count++] = 0;
+				} else {
+					vt->param_overflow = 1;
+				}
+			} else if (!vt->param_overflow) {
+				int *p = &vt->params[vt->param_count - 1];
+				*p = MIN(UVT_MAX_PARAM_VALUE, *p * 10 + (ch - '0'));
+			}
+			break;
+		case UVT_ESC_DISPATCH:
+			USTAT_ADD(ut, escapes[ch & 0x7F], 1);
+			handle_esc_dispatch(ut, ch);
+			break;
+		case UVT_CSI_DISPATCH:
+			USTAT_ADD(ut, escapes[ch & 0x7F], 1);
+			handle_csi_dispatch(ut, ch);
+			break;
+		case UVT_OSC_START:
+			vt->osc_len = 0;
+			break;
+		case UVT_OSC_PUT:
+			if (vt->osc_len < UVT_OSC_MAX) vt->osc[vt->osc_len++] = ch;
+			break;
+		case UVT_OSC_END: // 窗口标题等，没有宿主接口，忽略
+		case UVT_HOOK:    // DCS 序列，忽略
+		case UVT_PUT:
+		case UVT_UNHOOK:
+		case UVT_IGNORE:
 		default:
-			uterm_cell_putc(ch, cursorx, cursory);
-			cursorx++;
-			if (cursorx >= cell_cols) {
-				cursorx = 0;
-				cursory++;
-				if (cursory >= cell_lines) {
-					uterm_scroll();
-					cursory = cell_lines - 1;
+			break;
+	}
+}
+
+void uterm_ctx_putc(uterm_t *ut, char ch) {
+	uterm_ctx_write(ut, &ch, 1);
+}
+
+/*
+ * 表驱动的解析器。GROUND 状态下用 uscan_printable 找出连续的可打印字节一次写入，
+ * 0x80 以上的字节按 UTF-8 解码，其它字节查 uvt_table 得到动作和下一个状态。
+ */
+void uterm_ctx_write(uterm_t *ut, const char *buf, size_t len) {
+	const uint8_t *p = (const uint8_t *) buf;
+	const uint8_t *end = p + len;
+	vt100_t *vt = &ut->vtcontrol;
+	uint64_t start = USTAT_NOW(ut);
+
+	USTAT_ADD(ut, bytes, len);
+	while (p < end) {
+		if (vt->state == UVT_GROUND) {
+			if (*p >= 0x80) {
+				p = uterm_put_utf8(ut, p, end);
+				continue;
+			}
+			if (vt->utf8_need) uterm_utf8_abort(ut);
+
+			const uint8_t *run = p + uscan_printable(p, end - p);
+			if (run > p) {
+				while (p < run) {
+					p += uterm_put_run(ut, (const char *) p, run - p);
 				}
+				continue;
 			}
 		}
 
-	uterm_show_cursor(1); // 显示新光标
-	uterm_putcursor();
+		uint8_t ch = *p++;
+		uint8_t t = uvt_table[vt->state][ch];
+		uint8_t next = UVT_NEXT(t);
+
+		if (next) {
+			if (uvt_exit_action[vt->state]) uterm_vt_action(ut, uvt_exit_action[vt->state], ch);
+			uterm_vt_action(ut, UVT_ACTION(t), ch);
+			vt->state = next;
+			if (uvt_entry_action[next]) uterm_vt_action(ut, uvt_entry_action[next], ch);
+		} else {
+			uterm_vt_action(ut, UVT_ACTION(t), ch);
+		}
+	}
+	USTAT_TIME(ut, parse_time, start);
 }
 
-void uterm_puts(char *s){
-	char c = 0;
-	for (; *s; ++s) {
-		c = *s;
-		uterm_putc(c);
-	}
+void uterm_ctx_puts(uterm_t *ut, char *s){
+	uterm_ctx_write(ut, s, strlen(s));
 }
 
-void uterm_scroll() {
-	memmove(back_buffer->cell, back_buffer->cell + cell_cols, cell_cols * (cell_lines - 1) * sizeof(char));
-	memset(back_buffer->cell + cell_cols * (cell_lines - 1), 0, cell_cols * sizeof(char));
+/* 新的环建立成功后才替换，失败时保留原来的环 */
+int uterm_ctx_set_input_ring(uterm_t *ut, size_t size, int policy) {
+	uring_t ring;
 
-	for (int i = 0; i < (cell_lines - 1) * 16; i++) {
-		memmove(
-			back_buffer->fb + i * term_width,
-			back_buffer->fb + (i + 16) * term_width,
-			term_width * sizeof(uint32_t)
-		);
+	if (uring_init(&ring, size, policy, ut->umalloc) != 0) return -1;
+	uring_destroy(&ut->input, ut->ufree);
+	ut->input = ring;
+	return 0;
+}
+
+size_t uterm_ctx_enqueue(uterm_t *ut, const char *buf, size_t len) {
+	return uring_write(&ut->input, buf, len);
+}
+
+size_t uterm_ctx_drain(uterm_t *ut, size_t budget) {
+	char chunk[256];
+	size_t done = 0;
+
+	if (!ut->input.slots) return 0;
+
+	while (budget == 0 || done < budget) {
+		size_t want = sizeof(chunk);
+		if (budget != 0 && budget - done < want) want = budget - done;
+
+		size_t n = uring_read(&ut->input, chunk, want);
+		if (n == 0) break;
+		uterm_ctx_write(ut, chunk, n);
+		done += n;
+		if (n < want) break; // 已读空
 	}
 
-	// 清除最后 16 行的像素
-	for (int y = (cell_lines - 1) * 16; y < cell_lines * 16; y++) {
-		for (int x = 0; x < term_width; x++) {
-			back_buffer->fb[y * term_width + x] = 0x00000000; // 背景色
+	if (done > 0) uterm_ctx_flush(ut);
+	return done;
+}
+
+uint32_t uterm_ctx_input_dropped(uterm_t *ut) {
+	return uring_dropped(&ut->input);
+}
+
+int uterm_ctx_set_scrollback(uterm_t *ut, size_t budget) {
+	uscrollback_destroy(&ut->scrollback, ut->ufree);
+	return uscrollback_init(&ut->scrollback, budget, ut->cell_cols, ut->umalloc);
+}
+
+uint32_t uterm_ctx_scrollback_lines(uterm_t *ut) {
+	return ut->scrollback.count;
+}
+
+void uterm_ctx_view_history(uterm_t *ut, uint32_t lines) {
+	uint32_t history = ut->scrollback.count;
+
+	swap_buffers(ut); // 后缓冲中为最新的屏幕内容
+	if (lines == 0) return;
+	if (lines > history) lines = history;
+
+	uint8_t *fb = ut->present ? ut->pages[ut->page ^ 1] : ut->front_buffer.fb; // 双页时画到隐藏页
+
+	for (uint32_t y = 0; y < ut->cell_lines; y++) {
+		uint8_t *dst = fb + y * UGLYPH_HEIGHT * ut->pitch;
+
+		if (y < lines) {
+			uscrollback_get(&ut->scrollback, history - lines + y, ut->history_row);
+			uterm_map_cells(ut, ut->history_row, ut->cell_cols);
+			for (uint32_t x = 0; x < ut->cell_cols; x++) {
+				uterm_render_cell(ut, &ut->glyph_cache, fb, &ut->history_row[x], x, y, 0);
+			}
+		} else {
+			const uint8_t *src = ut->back_buffer.fb + uterm_phys_row(ut, y - lines) * UGLYPH_HEIGHT * ut->pitch;
+			memcpy(dst, src, UGLYPH_HEIGHT * ut->pitch);
 		}
+		uterm_mark_damage(ut, 0, ut->cell_cols, y); // 下一次 flush 时恢复
+	}
+	ut->cursor_drawn = 0;
+	if (ut->damage) ut->damage(0, 0, ut->cell_cols * UGLYPH_WIDTH, ut->cell_lines * UGLYPH_HEIGHT);
+
+	if (ut->present) {
+		ut->page_cursor_drawn[ut->page ^ 1] = 0;
+		ut->present(ut->page ^ 1);
+		ut->page ^= 1;
+	}
+}
+
+int uterm_ctx_set_pages(uterm_t *ut, uint32_t *page0, uint32_t *page1, void (*present)(int page)) {
+	size_t size = ut->cell_lines * ut->bitmap_stride * sizeof(uint32_t);
+
+	for (int i = 0; i < 2; i++) {
+		if (ut->page_damage[i]) ut->ufree(ut->page_damage[i]);
+		ut->page_damage[i] = NULL;
+	}
+	ut->pages[0] = ut->pages[1] = NULL;
+	ut->present = NULL;
+	ut->page = 0;
+
+	// 新的显存内容未知，全部重新复制
+	ut->front_buffer.fb = (uint8_t *) page0;
+	ut->cursor_drawn = 0;
+	for (uint32_t y = 0; y < ut->cell_lines; y++) {
+		uterm_mark_damage(ut, 0, ut->cell_cols, y);
 	}
 
-	// 标记整个屏幕为脏区域
-	back_buffer->dirty_start = 0;
-	back_buffer->dirty_end = cell_lines - 1;
+	if (!page1) return 0;
+	if (!present) return -1;
+
+	for (int i = 0; i < 2; i++) {
+		ut->page_damage[i] = (uint32_t *) ut->umalloc(size);
+		if (!ut->page_damage[i]) return -1;
+		memset(ut->page_damage[i], 0xFF, size); // 两页都未画过
+		ut->page_cursor_drawn[i] = 0;
+	}
+	ut->pages[0] = (uint8_t *) page0;
+	ut->pages[1] = (uint8_t *) page1;
+	ut->present = present;
+	return 0;
+}
+
+void uterm_ctx_set_damage_callback(uterm_t *ut, void (*damage)(int x, int y, int w, int h)) {
+	ut->damage = damage;
+}
+
+int uterm_ctx_get_stats(uterm_t *ut, uterm_stats_t *stats) {
+#ifdef UTERM_STATS
+	*stats = ut->stats;
+	return 0;
+#else
+	(void) ut;
+	memset(stats, 0, sizeof(uterm_stats_t));
+	return -1;
+#endif
+}
 
-	// 批量清除最后16行
-	// 清除最后16行的像素，使用当前背景色
-	uint32_t *last_lines = back_buffer->fb + (cell_lines - 1) * 16 * term_width;
-	for (int i = 0; i < 16 * term_width * 16; ++i) { // 16行高度
-		last_lines[i] = vtcontrol->current_bg;
+void uterm_ctx_reset_stats(uterm_t *ut) {
+#ifdef UTERM_STATS
+	memset(&ut->stats, 0, sizeof(uterm_stats_t));
+#else
+	(void) ut;
+#endif
 }
+
+void uterm_ctx_set_clock(uterm_t *ut, uint64_t (*clock)(void)) {
+#ifdef UTERM_STATS
+	ut->clock = clock;
+#else
+	(void) ut;
+	(void) clock;
+#endif
 }
 
-void uterm_flush(){
-	swap_buffers();
+void uterm_ctx_scroll(uterm_t *ut) {
+	USTAT_ADD(ut, scrolls, 1);
+	uscrollback_push(&ut->scrollback, uterm_line(ut, ut->back_buffer.cell, 0));
+
+	// 原来的第一行成为新的最后一行，像素和单元都不移动
+	ut->row_origin = uterm_phys_row(ut, 1);
+
+	// 使用当前背景色清空最后一行，像素在 flush 时绘制
+	ucell_t *last_line = uterm_line(ut, ut->back_buffer.cell, ut->cell_lines - 1);
+	for (uint32_t x = 0; x < ut->cell_cols; x++) {
+		uterm_blank_cell(ut, &last_line[x]);
+	}
+	uterm_mark_changed(ut, 0, ut->cell_cols, ut->cell_lines - 1);
+
+	// 屏幕上所有行都已移动，标记整个屏幕为损坏
+	for (uint32_t y = 0; y < ut->cell_lines; y++) {
+		uterm_mark_damage(ut, 0, ut->cell_cols, y);
+	}
+}
+
+void uterm_ctx_flush(uterm_t *ut){
+	swap_buffers(ut);
 	return;
 }
 
-void uterm_destroy(){
-	ufree(vtcontrol);
-	ufree(front_buffer->cell);
-	ufree(back_buffer->cell);
-	ufree(back_buffer->fb);
-	ufree(front_buffer);
-	ufree(back_buffer);
+void uterm_ctx_destroy(uterm_t *ut){
+	uterm_destroy_caches(ut);
+	uworker_pool_stop(&ut->workers, ut->ufree);
+	uglyph_map_destroy(&ut->glyph_map, ut->ufree);
+	uterm_release_font_file(ut);
+	ut->ufree(ut->front_buffer.cell);
+	ut->ufree(ut->back_buffer.cell);
+	ut->ufree(ut->back_buffer.changed);
+	ut->ufree(ut->back_buffer.damage);
+	ut->ufree(ut->raster_rows);
+	uring_destroy(&ut->input, ut->ufree);
+	uscrollback_destroy(&ut->scrollback, ut->ufree);
+	ut->ufree(ut->history_row);
+	for (int i = 0; i < 2; i++) {
+		if (ut->page_damage[i]) ut->ufree(ut->page_damage[i]);
+	}
+	ut->ufree(ut->back_buffer.fb);
+	ut->ufree(ut);
 	return;
 }
\ No newline at end of file
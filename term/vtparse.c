@@ -0,0 +1,156 @@
+#include <stdint.h>
+#include <vtparse.h>
+
+/*
+ * 转换表在编译时生成。每个状态先给出自己的转换，
+ * 再由 UVT_ANYWHERE 覆盖在任何状态下都有效的 CAN、SUB 和 ESC。
+ * 0x80 以上的字节按 UTF-8 处理，不解释为 C1 控制字符。
+ */
+#define T(action, state) (((action) << 4) | (state))
+
+// 后面的指定初始化有意覆盖前面的范围，-Wextra 下不报告
+#pragma GCC diagnostic ignored "-Woverride-init"
+
+#define UVT_ANYWHERE \
+	[0x18] = T(UVT_EXECUTE, UVT_GROUND), \
+	[0x1A] = T(UVT_EXECUTE, UVT_GROUND), \
+	[0x1B] = T(UVT_NONE, UVT_ESCAPE)
+
+#define UVT_C0(action) \
+	[0x00 ... 0x17] = T(action, 0), \
+	[0x19] = T(action, 0), \
+	[0x1C ... 0x1F] = T(action, 0)
+
+const uint8_t uvt_table[UVT_STATE_COUNT][256] = {
+	[UVT_GROUND] = {
+		UVT_C0(UVT_EXECUTE),
+		[0x20 ... 0x7E] = T(UVT_PRINT, 0),
+		[0x7F] = T(UVT_IGNORE, 0),
+		[0x80 ... 0xFF] = T(UVT_PRINT, 0),
+		UVT_ANYWHERE,
+	},
+	[UVT_ESCAPE] = {
+		UVT_C0(UVT_EXECUTE),
+		[0x20 ... 0x2F] = T(UVT_COLLECT, UVT_ESCAPE_INTERMEDIATE),
+		[0x30 ... 0x4F] = T(UVT_ESC_DISPATCH, UVT_GROUND),
+		[0x50] = T(UVT_NONE, UVT_DCS_ENTRY),
+		[0x51 ... 0x57] = T(UVT_ESC_DISPATCH, UVT_GROUND),
+		[0x58] = T(UVT_NONE, UVT_SOS_PM_APC_STRING),
+		[0x59 ... 0x5A] = T(UVT_ESC_DISPATCH, UVT_GROUND),
+		[0x5B] = T(UVT_NONE, UVT_CSI_ENTRY),
+		[0x5C] = T(UVT_ESC_DISPATCH, UVT_GROUND),
+		[0x5D] = T(UVT_NONE, UVT_OSC_STRING),
+		[0x5E ... 0x5F] = T(UVT_NONE, UVT_SOS_PM_APC_STRING),
+		[0x60 ... 0x7E] = T(UVT_ESC_DISPATCH, UVT_GROUND),
+		[0x7F ... 0xFF] = T(UVT_IGNORE, 0),
+		UVT_ANYWHERE,
+	},
+	[UVT_ESCAPE_INTERMEDIATE] = {
+		UVT_C0(UVT_EXECUTE),
+		[0x20 ... 0x2F] = T(UVT_COLLECT, 0),
+		[0x30 ... 0x7E] = T(UVT_ESC_DISPATCH, UVT_GROUND),
+		[0x7F ... 0xFF] = T(UVT_IGNORE, 0),
+		UVT_ANYWHERE,
+	},
+	[UVT_CSI_ENTRY] = {
+		UVT_C0(UVT_EXECUTE),
+		[0x20 ... 0x2F] = T(UVT_COLLECT, UVT_CSI_INTERMEDIATE),
+		[0x30 ... 0x3B] = T(UVT_PARAM, UVT_CSI_PARAM), // 含 ':' 子参数
+		[0x3C ... 0x3F] = T(UVT_COLLECT, UVT_CSI_PARAM), // 私有标记
+		[0x40 ... 0x7E] = T(UVT_CSI_DISPATCH, UVT_GROUND),
+		[0x7F ... 0xFF] = T(UVT_IGNORE, 0),
+		UVT_ANYWHERE,
+	},
+	[UVT_CSI_PARAM] = {
+		UVT_C0(UVT_EXECUTE),
+		[0x20 ... 0x2F] = T(UVT_COLLECT, UVT_CSI_INTERMEDIATE),
+		[0x30 ... 0x3B] = T(UVT_PARAM, 0),
+		[0x3C ... 0x3F] = T(UVT_NONE, UVT_CSI_IGNORE),
+		[0x40 ... 0x7E] = T(UVT_CSI_DISPATCH, UVT_GROUND),
+		[0x7F ... 0xFF] = T(UVT_IGNORE, 0),
+		UVT_ANYWHERE,
+	},
+	[UVT_CSI_INTERMEDIATE] = {
+		UVT_C0(UVT_EXECUTE),
+		[0x20 ... 0x2F] = T(UVT_COLLECT, 0),
+		[0x30 ... 0x3F] = T(UVT_NONE, UVT_CSI_IGNORE),
+		[0x40 ... 0x7E] = T(UVT_CSI_DISPATCH, UVT_GROUND),
+		[0x7F ... 0xFF] = T(UVT_IGNORE, 0),
+		UVT_ANYWHERE,
+	},
+	[UVT_CSI_IGNORE] = {
+		UVT_C0(UVT_EXECUTE),
+		[0x20 ... 0x3F] = T(UVT_IGNORE, 0),
+		[0x40 ... 0x7E] = T(UVT_NONE, UVT_GROUND),
+		[0x7F ... 0xFF] = T(UVT_IGNORE, 0),
+		UVT_ANYWHERE,
+	},
+	[UVT_DCS_ENTRY] = {
+		UVT_C0(UVT_IGNORE),
+		[0x20 ... 0x2F] = T(UVT_COLLECT, UVT_DCS_INTERMEDIATE),
+		[0x30 ... 0x39] = T(UVT_PARAM, UVT_DCS_PARAM),
+		[0x3A] = T(UVT_NONE, UVT_DCS_IGNORE),
+		[0x3B] = T(UVT_PARAM, UVT_DCS_PARAM),
+		[0x3C ... 0x3F] = T(UVT_COLLECT, UVT_DCS_PARAM),
+		[0x40 ... 0x7E] = T(UVT_NONE, UVT_DCS_PASSTHROUGH),
+		[0x7F ... 0xFF] = T(UVT_IGNORE, 0),
+		UVT_ANYWHERE,
+	},
+	[UVT_DCS_PARAM] = {
+		UVT_C0(UVT_IGNORE),
+		[0x20 ... 0x2F] = T(UVT_COLLECT, UVT_DCS_INTERMEDIATE),
+		[0x30 ... 0x39] = T(UVT_PARAM, 0),
+		[0x3A] = T(UVT_NONE, UVT_DCS_IGNORE),
+		[0x3B] = T(UVT_PARAM, 0),
+		[0x3C ... 0x3F] = T(UVT_NONE, UVT_DCS_IGNORE),
+		[0x40 ... 0x7E] = T(UVT_NONE, UVT_DCS_PASSTHROUGH),
+		[0x7F ... 0xFF] = T(UVT_IGNORE, 0),
+		UVT_ANYWHERE,
+	},
+	[UVT_DCS_INTERMEDIATE] = {
+		UVT_C0(UVT_IGNORE),
+		[0x20 ... 0x2F] = T(UVT_COLLECT, 0),
+		[0x30 ... 0x3F] = T(UVT_NONE, UVT_DCS_IGNORE),
+		[0x40 ... 0x7E] = T(UVT_NONE, UVT_DCS_PASSTHROUGH),
+		[0x7F ... 0xFF] = T(UVT_IGNORE, 0),
+		UVT_ANYWHERE,
+	},
+	[UVT_DCS_PASSTHROUGH] = {
+		UVT_C0(UVT_PUT),
+		[0x20 ... 0x7E] = T(UVT_PUT, 0),
+		[0x7F] = T(UVT_IGNORE, 0),
+		[0x80 ... 0xFF] = T(UVT_PUT, 0),
+		UVT_ANYWHERE,
+	},
+	[UVT_DCS_IGNORE] = {
+		UVT_C0(UVT_IGNORE),
+		[0x20 ... 0xFF] = T(UVT_IGNORE, 0),
+		UVT_ANYWHERE,
+	},
+	[UVT_OSC_STRING] = {
+		UVT_C0(UVT_IGNORE),
+		[0x07] = T(UVT_NONE, UVT_GROUND), // BEL 结束（xterm）
+		[0x20 ... 0x7E] = T(UVT_OSC_PUT, 0),
+		[0x7F] = T(UVT_IGNORE, 0),
+		[0x80 ... 0xFF] = T(UVT_OSC_PUT, 0),
+		UVT_ANYWHERE,
+	},
+	[UVT_SOS_PM_APC_STRING] = {
+		UVT_C0(UVT_IGNORE),
+		[0x20 ... 0xFF] = T(UVT_IGNORE, 0),
+		UVT_ANYWHERE,
+	},
+};
+
+const uint8_t uvt_entry_action[UVT_STATE_COUNT] = {
+	[UVT_ESCAPE] = UVT_CLEAR,
+	[UVT_CSI_ENTRY] = UVT_CLEAR,
+	[UVT_DCS_ENTRY] = UVT_CLEAR,
+	[UVT_DCS_PASSTHROUGH] = UVT_HOOK,
+	[UVT_OSC_STRING] = UVT_OSC_START,
+};
+
+const uint8_t uvt_exit_action[UVT_STATE_COUNT] = {
+	[UVT_DCS_PASSTHROUGH] = UVT_UNHOOK,
+	[UVT_OSC_STRING] = UVT_OSC_END,
+};
@@ -0,0 +1,149 @@
+#include <stdint.h>
+#include <string.h>
+#include <workers.h>
+
+static inline void uworker_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#else
+	__asm__ volatile("" ::: "memory");
+#endif
+}
+
+/* 等待新的任务，返回新的代数 */
+static uint32_t uworker_wait(uworker_pool_t *pool, uint32_t seen) {
+	uint32_t gen;
+
+#ifdef UTERM_PTHREADS
+	if (pool->use_pthreads) {
+		pthread_mutex_lock(&pool->lock);
+		while ((gen = __atomic_load_n(&pool->generation, __ATOMIC_ACQUIRE)) == seen) {
+			pthread_cond_wait(&pool->wake, &pool->lock);
+		}
+		pthread_mutex_unlock(&pool->lock);
+		return gen;
+	}
+#endif
+	while ((gen = __atomic_load_n(&pool->generation, __ATOMIC_ACQUIRE)) == seen) {
+		uworker_relax();
+	}
+	return gen;
+}
+
+static void uworker_main(void *arg) {
+	uworker_slot_t *slot = (uworker_slot_t *) arg;
+	uworker_pool_t *pool = slot->pool;
+	uint32_t seen = 0;
+
+	for (;;) {
+		seen = uworker_wait(pool, seen);
+		if (__atomic_load_n(&pool->stop, __ATOMIC_ACQUIRE)) break;
+
+		pool->job(pool->job_arg, slot->band);
+		__atomic_sub_fetch(&pool->pending, 1, __ATOMIC_RELEASE);
+	}
+	__atomic_sub_fetch(&pool->alive, 1, __ATOMIC_RELEASE);
+}
+
+#ifdef UTERM_PTHREADS
+static void *uworker_pthread_main(void *arg) {
+	uworker_main(arg);
+	return NULL;
+}
+#endif
+
+int uworker_pool_start(uworker_pool_t *pool, int nworkers, uworker_spawn_fn spawn, void *(*malloc)(size_t), void (*free)(void*)) {
+	memset(pool, 0, sizeof(uworker_pool_t));
+	if (nworkers <= 0) return 0;
+
+#ifndef UTERM_PTHREADS
+	if (!spawn) return -1; // 裸机构建必须由宿主提供线程
+#endif
+
+	pool->slots = (uworker_slot_t *) malloc(nworkers * sizeof(uworker_slot_t));
+#ifdef UTERM_PTHREADS
+	if (!spawn) {
+		pool->use_pthreads = 1;
+		pool->threads = (pthread_t *) malloc(nworkers * sizeof(pthread_t));
+		pthread_mutex_init(&pool->lock, NULL);
+		pthread_cond_init(&pool->wake, NULL);
+	}
+#endif
+
+	for (int i = 0; i < nworkers; i++) {
+		int ret;
+
+		pool->slots[i].pool = pool;
+		pool->slots[i].band = i + 1;
+		__atomic_add_fetch(&pool->alive, 1, __ATOMIC_RELAXED);
+#ifdef UTERM_PTHREADS
+		if (pool->use_pthreads)
+			ret = pthread_create(&pool->threads[i], NULL, uworker_pthread_main, &pool->slots[i]);
+		else
+#endif
+			ret = spawn(uworker_main, &pool->slots[i]);
+
+		if (ret != 0) {
+			__atomic_sub_fetch(&pool->alive, 1, __ATOMIC_RELAXED);
+			uworker_pool_stop(pool, free);
+			return -1;
+		}
+		pool->nworkers = i + 1;
+	}
+
+	return 0;
+}
+
+void uworker_pool_run(uworker_pool_t *pool, uworker_job_fn job, void *arg) {
+	pool->job = job;
+	pool->job_arg = arg;
+	__atomic_store_n(&pool->pending, pool->nworkers, __ATOMIC_RELAXED);
+
+#ifdef UTERM_PTHREADS
+	if (pool->use_pthreads) {
+		pthread_mutex_lock(&pool->lock);
+		__atomic_add_fetch(&pool->generation, 1, __ATOMIC_RELEASE);
+		pthread_cond_broadcast(&pool->wake);
+		pthread_mutex_unlock(&pool->lock);
+	} else
+#endif
+		__atomic_add_fetch(&pool->generation, 1, __ATOMIC_RELEASE);
+
+	job(arg, 0);
+
+	while (__atomic_load_n(&pool->pending, __ATOMIC_ACQUIRE) != 0) {
+		uworker_relax();
+	}
+}
+
+void uworker_pool_stop(uworker_pool_t *pool, void (*free)(void*)) {
+	if (!pool->slots) return;
+
+	__atomic_store_n(&pool->stop, 1, __ATOMIC_RELEASE);
+#ifdef UTERM_PTHREADS
+	if (pool->use_pthreads) {
+		pthread_mutex_lock(&pool->lock);
+		__atomic_add_fetch(&pool->generation, 1, __ATOMIC_RELEASE);
+		pthread_cond_broadcast(&pool->wake);
+		pthread_mutex_unlock(&pool->lock);
+
+		for (int i = 0; i < pool->nworkers; i++) {
+			pthread_join(pool->threads[i], NULL);
+		}
+		pthread_mutex_destroy(&pool->lock);
+		pthread_cond_destroy(&pool->wake);
+		free(pool->threads);
+	} else
+#endif
+	{
+		__atomic_add_fetch(&pool->generation, 1, __ATOMIC_RELEASE);
+	}
+
+	// 宿主线程从 entry 返回即退出，等待所有线程离开线程池
+	while (__atomic_load_n(&pool->alive, __ATOMIC_ACQUIRE) != 0) {
+		uworker_relax();
+	}
+
+	free(pool->slots);
+	memset(pool, 0, sizeof(uworker_pool_t));
+}
@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <string.h>
+#include <scan.h>
+
+/*
+ * uscan_printable 的单元测试：编译进来的每个内核（标量 SWAR、SSE2、AVX2 或 NEON）
+ * 与逐字节的参考实现比较。覆盖 0-64 的所有长度、0-63 的所有起始对齐，
+ * 以及在每个位置出现的边界字节。
+ */
+
+#define MAX_LEN 64
+#define MAX_ALIGN 64
+
+// 不可打印的边界字节，以及可打印范围的两端
+static const uint8_t stops[] = { 0x00, 0x1B, 0x1F, 0x7F, 0x80, 0xFF };
+static const uint8_t fills[] = { 0x20, 0x7E, 'a' };
+
+static size_t reference(const uint8_t *buf, size_t len) {
+    size_t i = 0;
+    while (i < len && buf[i] >= 0x20 && buf[i] <= 0x7E) i++;
+    return i;
+}
+
+// 检查一个内核，返回失败的次数
+static long check(uscan_fn fn, const char *name) {
+    static uint8_t mem[MAX_ALIGN + MAX_LEN + 64];
+    long failed = 0;
+
+    for (size_t align = 0; align < MAX_ALIGN; align++) {
+        uint8_t *buf = mem + align;
+
+        for (size_t len = 0; len <= MAX_LEN; len++) {
+            for (size_t f = 0; f < sizeof(fills); f++) {
+                for (size_t s = 0; s < sizeof(stops); s++) {
+                    // pos == len 时整段都可打印
+                    for (size_t pos = 0; pos <= len; pos++) {
+                        memset(mem, 0xFF, sizeof(mem)); // 范围外的字节不能影响结果
+                        for (size_t i = 0; i < len; i++) buf[i] = fills[(f + i) % sizeof(fills)];
+                        if (pos < len) buf[pos] = stops[s];
+
+                        size_t want = reference(buf, len);
+                        size_t got = fn(buf, len);
+                        if (got != want) {
+                            if (failed < 10) {
+                                printf("FAIL %s align=%zu len=%zu pos=%zu stop=0x%02X got=%zu want=%zu\n",
+                                    name, align, len, pos, stops[s], got, want);
+                            }
+                            failed++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return failed;
+}
+
+int main(void) {
+    long failed = 0;
+    const char *name;
+    uscan_fn fn;
+
+    for (int i = 0; (fn = uscan_kernel_at(i, &name)) != NULL || name != NULL; i++) {
+        if (!fn) {
+            printf("skip %s: not supported by this CPU\n", name);
+            continue;
+        }
+        long n = check(fn, name);
+        printf("%s %s\n", n ? "FAIL" : "ok", name);
+        failed += n;
+    }
+    return failed != 0;
+}
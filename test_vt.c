@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <context.h>
+
+/*
+ * 解析和单元写入的回归测试：向无显示的实例写入序列，检查单元内容、
+ * 颜色、属性和光标位置。context.h 的布局依赖编译选项，必须与库使用相同的定义。
+ */
+
+#define WIDTH  640
+#define HEIGHT 384
+
+static uint32_t fb[WIDTH * HEIGHT];
+static int failed = 0;
+
+static uterm_t *setup(const char *s) {
+    uterm_t *ut = uterm_ctx_create(fb, WIDTH, HEIGHT, malloc, free);
+    uterm_ctx_puts(ut, (char *) s);
+    return ut;
+}
+
+static const ucell_t *cell(uterm_t *ut, uint32_t x, uint32_t y) {
+    uint32_t row = (y + ut->row_origin) % ut->cell_lines;
+    return &ut->back_buffer.cell[row * ut->cell_cols + x];
+}
+
+static void expect(int ok, const char *name) {
+    printf("%s %s\n", ok ? "ok" : "FAIL", name);
+    if (!ok) failed++;
+}
+
+// 与 ESC[0m 之后写入的单元颜色和属性相同
+static int same_style(const ucell_t *a, const ucell_t *b) {
+    return a->fg == b->fg && a->bg == b->bg && a->attr == b->attr;
+}
+
+// 没有参数的 ESC[m 等于 ESC[0m，不能沿用上一个序列的参数
+static void test_sgr_reset(void) {
+    uterm_t *ut = setup("\033[31mA\033[mB\033[0mR");
+    expect(cell(ut, 0, 0)->fg != cell(ut, 2, 0)->fg, "sgr_red");
+    expect(same_style(cell(ut, 1, 0), cell(ut, 2, 0)), "sgr_bare_reset_after_color");
+    uterm_ctx_destroy(ut);
+
+    ut = setup("\033[1;44mC\033[mD\033[0mR");
+    expect(same_style(cell(ut, 1, 0), cell(ut, 2, 0)), "sgr_bare_reset_after_bold_bg");
+    uterm_ctx_destroy(ut);
+}
+
+// 调整大小失败时保留原来的环，之后的写入仍然有效
+static void test_input_ring_resize_fail(void) {
+    uterm_t *ut = setup("");
+    expect(uterm_ctx_set_input_ring(ut, (size_t) 1 << 26, UTERM_DROP_OLDEST) == -1, "ring_resize_too_big");
+    expect(uterm_ctx_enqueue(ut, "ok", 2) == 2, "ring_enqueue_after_failed_resize");
+    expect(uterm_ctx_drain(ut, 0) == 2 && cell(ut, 0, 0)->ch == 'o', "ring_drain_after_failed_resize");
+    uterm_ctx_destroy(ut);
+}
+
+// 制表符移到下一个 8 的倍数列，经过的单元保持不变
+static void test_tab(void) {
+    uterm_t *ut = setup("abcdefghij\rxy\tZ");
+    expect(ut->cursorx == 9 && cell(ut, 8, 0)->ch == 'Z', "tab_to_next_stop");
+    expect(cell(ut, 2, 0)->ch == 'c' && cell(ut, 7, 0)->ch == 'h', "tab_keeps_cells");
+    uterm_ctx_destroy(ut);
+
+    ut = setup("\033[1;78H\tE");
+    expect(cell(ut, ut->cell_cols - 1, 0)->ch == 'E', "tab_stops_at_last_column");
+    uterm_ctx_destroy(ut);
+}
+
+int main(void) {
+    test_sgr_reset();
+    test_input_ring_resize_fail();
+    test_tab();
+    return failed != 0;
+}